@@ -6,10 +6,33 @@
 #include <linux/types.h>
 #include <linux/uaccess.h>
 #include <linux/list.h>
+#include <linux/rculist.h>
 #include <linux/mutex.h>
+#include <linux/rcupdate.h>
 #include <linux/printk.h>
 #include <linux/device/class.h>
 #include <linux/version.h>
+#include <linux/slab.h>
+#include <linux/log2.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/atomic.h>
+#include <linux/pagemap.h>
+#include <linux/configfs.h>
+#include <linux/kobject.h>
+#include <linux/idr.h>
+#include <linux/hashtable.h>
+#include <linux/jhash.h>
+#include <linux/uio.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,7,0)
+#include <linux/io_uring/cmd.h>
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+#include <linux/io_uring.h>
+#endif
+
+#include "simpleFifo.h"
 
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Laurent Carlier <carlier.lau@gmail.com>");
@@ -17,214 +40,2380 @@ MODULE_AUTHOR("Laurent Carlier <carlier.lau@gmail.com>");
 static int simple_fifo_open(struct inode* inode, struct file* file);
 static ssize_t simple_fifo_write(struct file* file, char const* buf, size_t size, loff_t* offset);
 static ssize_t simple_fifo_read(struct file* file, char* buf, size_t size, loff_t* offset);
+static ssize_t simple_fifo_write_iter(struct kiocb* iocb, struct iov_iter* from);
+static ssize_t simple_fifo_read_iter(struct kiocb* iocb, struct iov_iter* to);
 static int simple_fifo_release(struct inode* inode, struct file* file);
+static long simple_fifo_ioctl(struct file* file, unsigned int cmd, unsigned long arg);
+static __poll_t simple_fifo_poll(struct file* file, poll_table* wait);
+static int simple_fifo_mmap(struct file* file, struct vm_area_struct* vma);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+static int simple_fifo_uring_cmd(struct io_uring_cmd* ioucmd, unsigned int issueFlags);
+#endif
 
 static const struct file_operations simpleFifo_fops = {
         .owner      = THIS_MODULE,
         .open = &simple_fifo_open,
         .write = &simple_fifo_write,
         .read = &simple_fifo_read,
-        .release = &simple_fifo_release
+        .write_iter = &simple_fifo_write_iter,
+        .read_iter = &simple_fifo_read_iter,
+        /*
+         * splice() and sendfile() go through read_iter and write_iter, the data being copied between the rings and
+         * the pages of the pipe without a user buffer.
+         */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,5,0)
+        .splice_read = &copy_splice_read,
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+        .splice_read = &direct_splice_read,
+#else
+        .splice_read = &generic_file_splice_read,
+#endif
+        .splice_write = &iter_file_splice_write,
+        .release = &simple_fifo_release,
+        .poll = &simple_fifo_poll,
+        .mmap = &simple_fifo_mmap,
+        .unlocked_ioctl = &simple_fifo_ioctl,
+        .compat_ioctl = &compat_ptr_ioctl,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+        .uring_cmd = &simple_fifo_uring_cmd,
+#endif
+};
+
+#define SIMPLE_FIFO_MIN_SIZE ((size_t)SIMPLE_FIFO_ATOMIC_SIZE)
+#define SIMPLE_FIFO_MAX_SIZE ((size_t)64 << 20)
+#define SIMPLE_FIFO_DEFAULT_SIZE ((size_t)64 << 10)
+#define SIMPLE_FIFO_MAX_FIFOS 256U
+
+static uint nb_fifos = 1;
+module_param(nb_fifos, uint, 0444);
+MODULE_PARM_DESC(nb_fifos, "Number of fifos created at load time, available as /dev/simplefifo-0 to /dev/simplefifo-<nb_fifos - 1> (1 to 256). The remaining minors are used by the fifos created through configfs");
+
+static unsigned long fifo_size = SIMPLE_FIFO_DEFAULT_SIZE;
+module_param(fifo_size, ulong, 0444);
+MODULE_PARM_DESC(fifo_size, "Default capacity in bytes of each reader ring (4KiB to 64MiB, rounded up to a power of two)");
+
+static bool broadcast;
+module_param(broadcast, bool, 0444);
+MODULE_PARM_DESC(broadcast, "Store written data once in a ring shared by all the readers instead of one ring per reader");
+
+static uint slow_reader_policy = SIMPLE_FIFO_POLICY_BLOCK;
+module_param(slow_reader_policy, uint, 0444);
+MODULE_PARM_DESC(slow_reader_policy, "Default policy of a reader without room for written data: 0 block the writer, 1 drop the oldest data, 2 drop the new data, 3 detach the reader");
+
+static bool record_mode;
+module_param(record_mode, bool, 0444);
+MODULE_PARM_DESC(record_mode, "Keep the boundaries of the writes: each write is a record and each read returns a whole record");
+
+/*
+ * In record mode, each record is stored in the rings preceded by its length.
+ */
+#define SIMPLE_FIFO_RECORD_HEADER sizeof(__u32)
+
+#define SIMPLE_FIFO_MAX_SLOT_SIZE 64U
+
+static uint slot_size;
+module_param(slot_size, uint, 0444);
+MODULE_PARM_DESC(slot_size, "Size in bytes of the fixed size elements exchanged through the fifo, a power of two up to 64. 0 for a byte stream");
+
+/*
+ * The offsets are free running: they are only wrapped with the capacity mask when the data is accessed. The amount of
+ * data pending for a reader is then simply the difference between the write offset of its ring and its read offset.
+ *
+ * A ring has a single producer, the writers being serialized, and each of its readers is the only one moving its read
+ * offset, unless the writers drop its oldest data. The offsets are therefore shared without a lock, like in a kfifo:
+ * the writer publishes writeOffset with a release store once the data is in the ring and the reader loads it with an
+ * acquire before reading the data. The reader publishes its read offset the same way once it is done with the data so
+ * that the writer never overwrites data still being copied.
+ */
+struct simple_fifo_ring {
+    uint8_t* data;
+    size_t capacity;
+    size_t writeOffset;
+    /*
+     * Readers of the ring sleep here until data is written.
+     */
+    wait_queue_head_t readWait;
+    /*
+     * The control page in front of the data of a private ring, which are both mapped by simple_fifo_mmap(). It mirrors
+     * the offsets for the user, the driver never reads it back. NULL for the shared ring.
+     */
+    struct simple_fifo_mmap_ctrl* ctrl;
+};
+
+/*
+ * A named channel of a fifo. Its readers are kept in their own list so that a write only walks the readers of its
+ * channel. It lives as long as a file is bound to it.
+ */
+struct simple_fifo_channel {
+    struct hlist_node node;
+    char name[SIMPLE_FIFO_CHANNEL_NAME_LEN];
+    /*
+     * Number of files bound to the channel, protected by the open_file_list_mutex of the fifo.
+     */
+    unsigned int refCount;
+    struct list_head opened_file_list;
+    /*
+     * In broadcast mode the readers bound to the channel share this ring, like the other readers share the one of
+     * the device. Unused otherwise.
+     */
+    struct simple_fifo_ring ring;
 };
 
-#define MAX_FIFO_SIZE ((uint8_t)64)
+#define SIMPLE_FIFO_CHANNEL_HASH_BITS 6
 
+/*
+ * Each minor is an independent fifo with its own readers and locks.
+ *
+ * Lock ordering: write_mutex, then the read_mutex of a file, then open_file_list_mutex.
+ *
+ * open_file_list_mutex serializes the updates of the lists of opened files and of the channel table. The writers walk
+ * the list under RCU so opening or releasing a file never waits for a write in progress, nor the other way around,
+ * except for the readers of a shared ring, which are published under write_mutex. write_mutex serializes the writers
+ * and the resizing of the rings. Readers take neither so that readers of different files run in parallel and don't
+ * wait for writers.
+ */
 struct simpleFifo_device_data {
     struct device *dev;
     struct cdev cdev;
     struct mutex open_file_list_mutex;
+    /*
+     * The readers which are not bound to a channel.
+     */
     struct list_head opened_file_list;
+    DECLARE_HASHTABLE(channels, SIMPLE_FIFO_CHANNEL_HASH_BITS);
+    struct mutex write_mutex;
+    size_t capacity;
+    bool broadcast;
+    unsigned int policy;
+    /*
+     * Only changed while no file is opened, with write_mutex held. A file is opened without that lock, so its writers
+     * read it under write_mutex.
+     */
+    bool recordMode;
+    /*
+     * Size of the elements when not 0, changed like recordMode. The rings are naturally aligned and their capacity is a
+     * multiple of the size so that each element sits in its own slot, never across a cache line or the end of a ring.
+     */
+    unsigned int slotSize;
+    atomic_t openCount;
+    struct simple_fifo_ring sharedRing;
+    /*
+     * Writers sleep here until a reader frees some space. spaceGeneration is incremented each time that happens so
+     * that a writer can wait for it without walking the reader list.
+     */
+    wait_queue_head_t writeWait;
+    atomic_long_t spaceGeneration;
+    /*
+     * Lower bound of the space the readers in writableReaders have left, see simple_fifo_cached_writable(). Protected
+     * by write_mutex. readersGeneration is incremented each time a reader may have less space than that: when it is
+     * added to a list of readers, its ring is resized or its policy changes.
+     */
+    size_t writable;
+    struct list_head* writableReaders;
+    int writableGeneration;
+    atomic_t readersGeneration;
 };
 
 struct file_private_data {
     struct simpleFifo_device_data* parent;
+    /*
+     * Only the files opened for reading are in the list of opened files, the list of the device or the one of their
+     * channel.
+     */
     struct list_head file_entry;
-    uint8_t data[MAX_FIFO_SIZE];
-    uint8_t writeOffset;
-    uint8_t readOffset;
-    uint8_t size;
+    /*
+     * NULL until the file is bound to a channel.
+     */
+    struct simple_fifo_channel* channel;
+    /*
+     * Points to privateRing, or to the sharedRing of the parent when the device is in broadcast mode. A file opened
+     * write only has no ring.
+     */
+    struct simple_fifo_ring* ring;
+    struct simple_fifo_ring privateRing;
+    /*
+     * Serializes the readers of the file. It is held while the data is copied to the user so that the part of the
+     * ring being read can't be released.
+     */
+    struct mutex read_mutex;
+    size_t readOffset;
+    /*
+     * One of the SIMPLE_FIFO_POLICY_*. It is only changed with both write_mutex and read_mutex held.
+     */
+    unsigned int policy;
+    /*
+     * Set by a writer when the policy of the file is SIMPLE_FIFO_POLICY_DETACH and its reader is too slow. The file
+     * then no longer receives data.
+     */
+    bool detached;
+    /*
+     * Serializes simple_fifo_mmap() with the resizing of the ring and the policy changes, which are not allowed once
+     * the ring is mapped. It is taken last as mmap runs with mmap_lock held.
+     */
+    struct mutex map_mutex;
+    bool mapped;
+    /*
+     * Staging area mapped by the writer, see SIMPLE_FIFO_IOC_COMMIT. It is set once under map_mutex and kept until
+     * the file is released.
+     */
+    uint8_t* staging;
+    size_t stagingSize;
+    struct rcu_head rcu;
 };
 
 static int dev_major;
 static struct class* my_class;
-static struct simpleFifo_device_data simpleFifo_data;
+static struct simpleFifo_device_data* simpleFifo_devices;
+/*
+ * The private data of the opened files. The objects are cache line aligned so that the read offset updated by the
+ * reader of a file doesn't share a cache line with the private data of another file.
+ */
+static struct kmem_cache* fpd_cache;
+/*
+ * Capacity of the fifos created at load time, validated from fifo_size. It is also the initial capacity of the fifos
+ * created through configfs.
+ */
+static size_t fifo_capacity;
+/*
+ * Minors of the fifos created through configfs, between nb_fifos and SIMPLE_FIFO_MAX_FIFOS - 1.
+ */
+static DEFINE_IDA(simple_fifo_minors);
 
-static int __init simple_fifo_init(void)
+/*
+ * Validates a capacity requested by the user and rounds it up to the next power of two so that offsets in the
+ * ring can be wrapped with a mask.
+ */
+static int simple_fifo_check_size(__u64 requestedSize, size_t* capacity)
 {
-	int err;
-	dev_t devNumber;
-
-	err = alloc_chrdev_region(&devNumber, 0, 1, "simpleFifo");
-    if(err < 0)
+    if(requestedSize < SIMPLE_FIFO_MIN_SIZE || requestedSize > SIMPLE_FIFO_MAX_SIZE)
     {
-        return 1;
+        return -EINVAL;
     }
+    *capacity = roundup_pow_of_two((size_t)requestedSize);
+    return 0;
+}
 
-	dev_major = MAJOR(devNumber);
+static int simple_fifo_check_policy(bool isBroadcast, unsigned int policy)
+{
+    /*
+     * The new data can't be dropped for a single reader of a shared ring.
+     */
+    if(policy > SIMPLE_FIFO_POLICY_DETACH || (isBroadcast && policy == SIMPLE_FIFO_POLICY_DROP_NEWEST))
+    {
+        return -EINVAL;
+    }
+    return 0;
+}
 
-#if LINUX_VERSION_CODE < KERNEL_VERSION(6,4,0)
-	my_class = class_create(THIS_MODULE, "simpleFifo");
-#else
-	my_class = class_create("simpleFifo");
-#endif
-    if(my_class == NULL)
+/*
+ * Fixed size elements don't need any framing so they can't be combined with the record mode.
+ */
+static int simple_fifo_check_framing(bool recordMode, unsigned int slotSize)
+{
+    if(slotSize != 0 && ((slotSize & (slotSize - 1)) != 0 || slotSize > SIMPLE_FIFO_MAX_SLOT_SIZE || recordMode))
     {
-        goto unregister_chrdev_region;
+        return -EINVAL;
     }
+    return 0;
+}
 
-    cdev_init(&simpleFifo_data.cdev, &simpleFifo_fops);
-    simpleFifo_data.cdev.owner = THIS_MODULE;
-    err = cdev_add(&simpleFifo_data.cdev, MKDEV(dev_major, 0), 1);
-    if(err < 0)
+/*
+ * Allocates a control page followed by the data of a ring of the given capacity, in memory which can be mapped to the
+ * user.
+ */
+static struct simple_fifo_mmap_ctrl* simple_fifo_ctrl_alloc(size_t capacity)
+{
+    struct simple_fifo_mmap_ctrl* ctrl = vmalloc_user(PAGE_SIZE + capacity);
+
+    if(ctrl != NULL)
     {
-        goto unregister_chrdev_region;
+        ctrl->capacity = capacity;
     }
+    return ctrl;
+}
 
-    simpleFifo_data.dev = device_create(my_class, NULL, MKDEV(dev_major, 0), NULL, "simplefifo-%d", 0);
-    if(simpleFifo_data.dev == NULL)
+/*
+ * The data of a private ring can be mapped, it follows the control page.
+ */
+static int simple_fifo_ring_alloc(struct simple_fifo_ring* ring, size_t capacity, bool mappable)
+{
+    if(mappable)
+    {
+        ring->ctrl = simple_fifo_ctrl_alloc(capacity);
+        ring->data = ring->ctrl != NULL ? (uint8_t*)ring->ctrl + PAGE_SIZE : NULL;
+    }
+    else
+    {
+        ring->ctrl = NULL;
+        ring->data = kvmalloc(capacity, GFP_KERNEL);
+    }
+    if(ring->data == NULL)
     {
-        goto cdev_del;
+        return -ENOMEM;
     }
+    ring->capacity = capacity;
+    ring->writeOffset = 0;
+    init_waitqueue_head(&ring->readWait);
+    return 0;
+}
 
-    mutex_init(&simpleFifo_data.open_file_list_mutex);
-    INIT_LIST_HEAD(&simpleFifo_data.opened_file_list);
+static void simple_fifo_ring_free(struct simple_fifo_mmap_ctrl* ctrl, uint8_t* data)
+{
+    if(ctrl != NULL)
+    {
+        vfree(ctrl);
+    }
+    else
+    {
+        kvfree(data);
+    }
+}
 
-    printk("Simple fifo registered\n");
+/*
+ * Reader side: returns how many bytes can be read from the ring of the file. The data is visible once this returns.
+ * A detached reader of a shared ring may have been overtaken by the writers, what it reports is bounded by the
+ * capacity.
+ */
+static size_t simple_fifo_pending(struct file_private_data* fpd)
+{
+    struct simple_fifo_ring* ring = fpd->ring;
+    size_t writeOffset = smp_load_acquire(&ring->writeOffset);
 
-	return 0;
+    return min(writeOffset - READ_ONCE(fpd->readOffset), ring->capacity);
+}
 
-cdev_del:
-    cdev_del(&simpleFifo_data.cdev);
-unregister_chrdev_region:
-    unregister_chrdev_region(MKDEV(dev_major, 0), MINORMASK);
-    return 1;
+/*
+ * Writer side: returns how many bytes can be written in the ring of the file without overwriting data its reader has
+ * not consumed yet.
+ */
+static size_t simple_fifo_free_space(struct file_private_data* fpd)
+{
+    return fpd->ring->capacity - (READ_ONCE(fpd->ring->writeOffset) - smp_load_acquire(&fpd->readOffset));
 }
 
-static int simple_fifo_open(struct inode* inode, struct file* file)
+/*
+ * Makes len bytes written at the write offset of the ring visible to its readers.
+ */
+static void simple_fifo_ring_commit(struct simple_fifo_ring* ring, size_t len)
 {
-    struct simpleFifo_device_data *data = container_of(inode->i_cdev, struct simpleFifo_device_data, cdev);
+    smp_store_release(&ring->writeOffset, ring->writeOffset + len);
+    if(ring->ctrl != NULL)
+    {
+        /*
+         * Orders the data before the offset seen through the mapping.
+         */
+        smp_wmb();
+        WRITE_ONCE(ring->ctrl->writeOffset, ring->writeOffset);
+    }
+}
 
-    struct file_private_data* fpd = devm_kzalloc(data->dev, sizeof(struct file_private_data), GFP_KERNEL);
-    if(fpd == NULL)
+/*
+ * Reader side: releases the data before readOffset to the writers once the reader is done with it. The control page
+ * mirrors the read offset of the files whose policy is not SIMPLE_FIFO_POLICY_DROP_OLDEST, only their reader moves it.
+ */
+static void simple_fifo_release_read_offset(struct file_private_data* fpd, size_t readOffset)
+{
+    smp_store_release(&fpd->readOffset, readOffset);
+    if(fpd->ring->ctrl != NULL)
     {
-        return -ENOMEM;
+        WRITE_ONCE(fpd->ring->ctrl->readOffset, readOffset);
     }
-    mutex_lock(&data->open_file_list_mutex);
-    INIT_LIST_HEAD(&fpd->file_entry);
-    list_add(&fpd->file_entry, &data->opened_file_list);
-    fpd->parent = data;
-    file->private_data = (void*)fpd;
-    fpd->readOffset = 0;
-    fpd->writeOffset = 0;
-    fpd->size = 0;
-    mutex_unlock(&data->open_file_list_mutex);
-    return 0;
 }
 
-static ssize_t simple_fifo_write(struct file* file, char const* buf, size_t size, loff_t* offset)
+static void simple_fifo_ring_copy_to_buf(struct simple_fifo_ring const* ring, size_t offset, uint8_t* buf, size_t len);
+
+/*
+ * Returns the offset of the first record of the ring starting at or after target, walking the records from offset.
+ * The records between the read and the write offsets of a ring are only overwritten by the writers.
+ */
+static size_t simple_fifo_record_boundary(struct simple_fifo_ring const* ring, size_t offset, size_t target)
 {
-    uint8_t dataFromUser[MAX_FIFO_SIZE];
-    uint8_t idx;
-    uint8_t nbBytesToCopy = min(size, ((size_t)MAX_FIFO_SIZE));
-    struct list_head* curListHead;
-    struct simpleFifo_device_data* parent;
+    __u32 recordLen;
 
-    struct file_private_data *writenFilePd = (struct file_private_data *) file->private_data;
-    int isWrittenFileWriteOnly = (file->f_flags & O_WRONLY) != 0;
-    parent = writenFilePd->parent;
+    while((ssize_t)(target - offset) > 0)
+    {
+        simple_fifo_ring_copy_to_buf(ring, offset, (uint8_t*)&recordLen, SIMPLE_FIFO_RECORD_HEADER);
+        offset += SIMPLE_FIFO_RECORD_HEADER + recordLen;
+    }
+    return offset;
+}
 
-    mutex_lock(&parent->open_file_list_mutex);
-    list_for_each(curListHead, &parent->opened_file_list)
+/*
+ * Writer side: moves the read offset of the file forward so that len bytes can be written in its ring. In record mode,
+ * whole records are dropped. The reader may be moving its read offset at the same time so it is only replaced if it
+ * hasn't changed in between. The full barrier of a successful cmpxchg orders the move before the data overwriting the
+ * dropped data is written.
+ */
+static void simple_fifo_drop_oldest(struct file_private_data* fpd, size_t len)
+{
+    size_t target = fpd->ring->writeOffset + len - fpd->ring->capacity;
+    size_t newReadOffset;
+    size_t readOffset;
+
+    do
     {
-        struct file_private_data *curFpd = list_entry(curListHead, struct file_private_data, file_entry);
-        if (curFpd->size == MAX_FIFO_SIZE) {
-            mutex_unlock(&parent->open_file_list_mutex);
-            return 0;
+        readOffset = READ_ONCE(fpd->readOffset);
+        if((ssize_t)(target - readOffset) <= 0)
+        {
+            return;
         }
+        newReadOffset = fpd->parent->recordMode ? simple_fifo_record_boundary(fpd->ring, readOffset, target) : target;
+    } while(cmpxchg(&fpd->readOffset, readOffset, newReadOffset) != readOffset);
+}
+
+/*
+ * Applies the policy of a file whose ring doesn't have room for len bytes. Returns true when the data can be stored
+ * in the ring of the file afterwards.
+ */
+static bool simple_fifo_make_room(struct file_private_data* fpd, size_t len)
+{
+    /*
+     * A reader opened with a ring too small for the data after the space was checked.
+     */
+    if(len > fpd->ring->capacity)
+    {
+        return false;
+    }
+    switch(fpd->policy)
+    {
+        case SIMPLE_FIFO_POLICY_DROP_OLDEST:
+            simple_fifo_drop_oldest(fpd, len);
+            return true;
+        case SIMPLE_FIFO_POLICY_DETACH:
+            WRITE_ONCE(fpd->detached, true);
+            if(fpd->ring->ctrl != NULL)
+            {
+                WRITE_ONCE(fpd->ring->ctrl->detached, 1);
+            }
+            wake_up_interruptible_poll(&fpd->ring->readWait, EPOLLHUP);
+            return false;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Returns the list of the readers receiving the data written by the file.
+ */
+static struct list_head* simple_fifo_readers(struct file_private_data* fpd)
+{
+    struct simple_fifo_channel* channel = READ_ONCE(fpd->channel);
+
+    return channel != NULL ? &channel->opened_file_list : &fpd->parent->opened_file_list;
+}
+
+/*
+ * Returns the ring shared by the given readers in broadcast mode: the one of their channel, or the one of the device.
+ */
+static struct simple_fifo_ring* simple_fifo_shared_ring(struct simpleFifo_device_data* parent, struct list_head* readers)
+{
+    if(readers == &parent->opened_file_list)
+    {
+        return &parent->sharedRing;
+    }
+    return &container_of(readers, struct simple_fifo_channel, opened_file_list)->ring;
+}
+
+/*
+ * Returns how many bytes of a write of size bytes can be accepted. This is limited by the reader having the least
+ * space left in its ring among the readers blocking the writers. Must be called under rcu_read_lock.
+ */
+static size_t simple_fifo_writable(struct list_head* readers, size_t size)
+{
+    struct file_private_data *curFpd;
+    size_t writable = min(size, SIMPLE_FIFO_MAX_SIZE);
 
-        if(curFpd->size + size > MAX_FIFO_SIZE)
+    list_for_each_entry_rcu(curFpd, readers, file_entry)
+    {
+        if(READ_ONCE(curFpd->detached))
         {
-            uint8_t spaceRemaingInFifo = MAX_FIFO_SIZE - curFpd->size;
-            nbBytesToCopy = min(nbBytesToCopy, spaceRemaingInFifo);
+            continue;
+        }
+        if(READ_ONCE(curFpd->policy) == SIMPLE_FIFO_POLICY_BLOCK)
+        {
+            writable = min(writable, simple_fifo_free_space(curFpd));
         }
         else
         {
-            nbBytesToCopy = min((size_t)nbBytesToCopy, size);
+            /*
+             * The data is made room for or dropped when it is stored. It must still fit in the ring.
+             */
+            writable = min(writable, curFpd->ring->capacity);
+        }
+        if(writable == 0)
+        {
+            break;
         }
     }
+    return writable;
+}
+
+/*
+ * Same as simple_fifo_writable() without walking the readers most of the time. Only the writers, which are serialized,
+ * use up space in the rings. The space left by the last walk, minus what has been written since, is therefore a lower
+ * bound of the space available as long as no reader has been added or changed. The readers are only walked again
+ * when that bound is too small for the write. Must be called with write_mutex held and under rcu_read_lock.
+ */
+static size_t simple_fifo_cached_writable(struct simpleFifo_device_data* parent, struct list_head* readers, size_t size)
+{
+    int generation = atomic_read(&parent->readersGeneration);
 
-    if(copy_from_user(&dataFromUser, buf, nbBytesToCopy))
+    if(parent->writableReaders != readers || parent->writableGeneration != generation || parent->writable < size)
     {
-        mutex_unlock(&parent->open_file_list_mutex);
-        return -EFAULT;
+        parent->writable = simple_fifo_writable(readers, SIMPLE_FIFO_MAX_SIZE);
+        /*
+         * The readers don't bound the write when none of them receives it, when they are all detached or when only
+         * write only files are opened. The shared ring still does.
+         */
+        if(parent->broadcast)
+        {
+            parent->writable = min(parent->writable, simple_fifo_shared_ring(parent, readers)->capacity);
+        }
+        parent->writableReaders = readers;
+        parent->writableGeneration = generation;
     }
-    list_for_each(curListHead, &parent->opened_file_list)
+    return min(size, parent->writable);
+}
+
+/*
+ * Record mode counterpart of simple_fifo_writable(): returns 1 when a record of len bytes, header included, can be
+ * stored, 0 when a reader blocking the writers doesn't have room for it yet and -EMSGSIZE when it can't fit in the
+ * ring of a reader. Must be called under rcu_read_lock.
+ */
+static int simple_fifo_record_writable(struct list_head* readers, size_t len)
+{
+    struct file_private_data *curFpd;
+
+    list_for_each_entry_rcu(curFpd, readers, file_entry)
     {
-        struct file_private_data *curFpd = list_entry(curListHead, struct file_private_data, file_entry);
-        if(isWrittenFileWriteOnly && (curFpd == writenFilePd))
+        if(READ_ONCE(curFpd->detached))
         {
             continue;
         }
-        for(idx = 0; idx < nbBytesToCopy; idx++)
+        if(len > curFpd->ring->capacity)
         {
-            curFpd->data[curFpd->writeOffset] = dataFromUser[idx];
-            ++curFpd->writeOffset;
-            curFpd->writeOffset %= MAX_FIFO_SIZE;
+            return -EMSGSIZE;
+        }
+        if(READ_ONCE(curFpd->policy) == SIMPLE_FIFO_POLICY_BLOCK && len > simple_fifo_free_space(curFpd))
+        {
+            return 0;
         }
-        curFpd->size += nbBytesToCopy;
     }
-    mutex_unlock(&parent->open_file_list_mutex);
-    return nbBytesToCopy;
+    return 1;
 }
 
-static ssize_t simple_fifo_read(struct file* file, char* buf, size_t size, loff_t* offset)
+/*
+ * Wakes up the writers waiting for space.
+ *
+ * The wake-ups carry the poll events they signal so that epoll only wakes the waiters interested in them. This
+ * matters for EPOLLEXCLUSIVE waiters which are woken one at a time.
+ */
+static void simple_fifo_space_freed(struct simpleFifo_device_data* parent)
 {
-    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
-    struct simpleFifo_device_data *parent = fpd->parent;
-    uint8_t dataToUser[MAX_FIFO_SIZE];
-    uint8_t idx;
+    atomic_long_inc(&parent->spaceGeneration);
+    wake_up_interruptible_poll(&parent->writeWait, EPOLLOUT | EPOLLWRNORM);
+}
 
-    mutex_lock(&parent->open_file_list_mutex);
-    if(fpd->size == 0)
+/*
+ * The helpers below move data in and out of a ring with one copy per contiguous segment: up to the end of the
+ * buffer, then from its beginning when the data wraps. They don't update the offsets of the ring.
+ */
+static int simple_fifo_ring_copy_from_user(struct simple_fifo_ring* ring, size_t offset, char const __user* buf, size_t len)
+{
+    size_t start = offset & (ring->capacity - 1);
+    size_t firstLen = min(len, ring->capacity - start);
+
+    if(copy_from_user(ring->data + start, buf, firstLen))
     {
-        mutex_unlock(&parent->open_file_list_mutex);
-        return 0;
+        return -EFAULT;
+    }
+    if(firstLen < len && copy_from_user(ring->data, buf + firstLen, len - firstLen))
+    {
+        return -EFAULT;
     }
-    size = min((size_t)fpd->size, size);
-    for(idx = 0; idx < size; idx++)
+    return 0;
+}
+
+static int simple_fifo_ring_copy_to_user(struct simple_fifo_ring const* ring, size_t offset, char __user* buf, size_t len)
+{
+    size_t start = offset & (ring->capacity - 1);
+    size_t firstLen = min(len, ring->capacity - start);
+
+    if(copy_to_user(buf, ring->data + start, firstLen))
     {
-        dataToUser[idx] = fpd->data[fpd->readOffset];
-        ++fpd->readOffset;
-        fpd->readOffset %= MAX_FIFO_SIZE;
+        return -EFAULT;
     }
-    if(copy_to_user(buf, dataToUser, size))
+    if(firstLen < len && copy_to_user(buf + firstLen, ring->data, len - firstLen))
     {
-        mutex_unlock(&parent->open_file_list_mutex);
         return -EFAULT;
     }
-    fpd->size -= size;
-    mutex_unlock(&parent->open_file_list_mutex);
-    return idx;
+    return 0;
 }
 
-static int simple_fifo_release(struct inode* inode, struct file* file)
+/*
+ * The iov_iter counterparts of the helpers above. The iterator is reverted when the user memory is not all copied so
+ * that the copy can be retried.
+ */
+static int simple_fifo_ring_copy_from_iter(struct simple_fifo_ring* ring, size_t offset, struct iov_iter* from, size_t len)
 {
-    struct file_private_data* fpd = (struct file_private_data*)file->private_data;
-    struct simpleFifo_device_data* parent = fpd->parent;
+    size_t start = offset & (ring->capacity - 1);
+    size_t firstLen = min(len, ring->capacity - start);
+    size_t copied = copy_from_iter(ring->data + start, firstLen, from);
 
-    mutex_lock(&parent->open_file_list_mutex);
-    list_del(&fpd->file_entry);
-    devm_kfree(parent->dev, fpd);
-    mutex_unlock(&parent->open_file_list_mutex);
+    if(copied == firstLen && firstLen < len)
+    {
+        copied += copy_from_iter(ring->data, len - firstLen, from);
+    }
+    if(copied != len)
+    {
+        iov_iter_revert(from, copied);
+        return -EFAULT;
+    }
     return 0;
-};
+}
 
-static void __exit simple_fifo_exit(void)
+static int simple_fifo_ring_copy_to_iter(struct simple_fifo_ring const* ring, size_t offset, struct iov_iter* to, size_t len)
 {
-	device_destroy(my_class, MKDEV(dev_major, 0));
-    class_destroy(my_class);
+    size_t start = offset & (ring->capacity - 1);
+    size_t firstLen = min(len, ring->capacity - start);
+    size_t copied = copy_to_iter(ring->data + start, firstLen, to);
+
+    if(copied == firstLen && firstLen < len)
+    {
+        copied += copy_to_iter(ring->data, len - firstLen, to);
+    }
+    if(copied != len)
+    {
+        iov_iter_revert(to, copied);
+        return -EFAULT;
+    }
+    return 0;
+}
+
+static void simple_fifo_ring_copy_to_buf(struct simple_fifo_ring const* ring, size_t offset, uint8_t* buf, size_t len)
+{
+    size_t start = offset & (ring->capacity - 1);
+    size_t firstLen = min(len, ring->capacity - start);
+
+    memcpy(buf, ring->data + start, firstLen);
+    memcpy(buf + firstLen, ring->data, len - firstLen);
+}
+
+static void simple_fifo_ring_copy_from_buf(struct simple_fifo_ring* ring, size_t offset, uint8_t const* buf, size_t len)
+{
+    size_t start = offset & (ring->capacity - 1);
+    size_t firstLen = min(len, ring->capacity - start);
+
+    memcpy(ring->data + start, buf, firstLen);
+    memcpy(ring->data, buf + firstLen, len - firstLen);
+}
+
+/*
+ * Copies len bytes of user data, from buf or from the iterator when there is one, at the write offset of the ring,
+ * preceded by their length in record mode. Returns how many bytes have been stored.
+ */
+static ssize_t simple_fifo_ring_fill(struct simple_fifo_ring* ring, char const __user* buf, struct iov_iter* from,
+                                     size_t len, bool record)
+{
+    size_t offset = ring->writeOffset;
+    __u32 recordLen = len;
+    int err;
+
+    if(record)
+    {
+        simple_fifo_ring_copy_from_buf(ring, offset, (uint8_t const*)&recordLen, SIMPLE_FIFO_RECORD_HEADER);
+        offset += SIMPLE_FIFO_RECORD_HEADER;
+    }
+    pagefault_disable();
+    if(from != NULL)
+    {
+        err = simple_fifo_ring_copy_from_iter(ring, offset, from, len);
+    }
+    else
+    {
+        err = simple_fifo_ring_copy_from_user(ring, offset, buf, len);
+    }
+    pagefault_enable();
+    if(err < 0)
+    {
+        return err;
+    }
+    return offset - ring->writeOffset + len;
+}
+
+/*
+ * Copies len bytes starting at srcOffset in src at the write offset of dst. The rings may wrap at different places
+ * so up to three copies are needed.
+ */
+static void simple_fifo_ring_copy(struct simple_fifo_ring* dst, struct simple_fifo_ring const* src, size_t srcOffset, size_t len)
+{
+    size_t dstOffset = dst->writeOffset;
+
+    while(len != 0)
+    {
+        size_t srcStart = srcOffset & (src->capacity - 1);
+        size_t dstStart = dstOffset & (dst->capacity - 1);
+        size_t chunk = min3(len, src->capacity - srcStart, dst->capacity - dstStart);
+
+        memcpy(dst->data + dstStart, src->data + srcStart, chunk);
+        srcOffset += chunk;
+        dstOffset += chunk;
+        len -= chunk;
+    }
+}
+
+/*
+ * Copies len bytes of user data in the rings of the readers and commits them, as one record in record mode. The user
+ * data is copied in the first receiving ring only, the other readers get a kernel copy from that ring instead of
+ * faulting in the user pages again.
+ *
+ * This runs under rcu_read_lock so page faults are disabled while the user data is copied. -EFAULT is returned when
+ * the user pages are not present, before any ring has been committed.
+ */
+static int simple_fifo_store(struct simpleFifo_device_data* parent, struct list_head* readers, char const __user* buf,
+                             struct iov_iter* from, size_t len)
+{
+    struct file_private_data *curFpd;
+    struct simple_fifo_ring* firstRing = NULL;
+    struct simple_fifo_ring* sharedRing;
+    size_t storedLen = parent->recordMode ? SIMPLE_FIFO_RECORD_HEADER + len : len;
+    ssize_t err;
+
+    if(parent->broadcast)
+    {
+        /*
+         * The data is stored once whatever the number of readers.
+         */
+        sharedRing = simple_fifo_shared_ring(parent, readers);
+        list_for_each_entry_rcu(curFpd, readers, file_entry)
+        {
+            if(!curFpd->detached && storedLen > simple_fifo_free_space(curFpd))
+            {
+                simple_fifo_make_room(curFpd, storedLen);
+            }
+        }
+        err = simple_fifo_ring_fill(sharedRing, buf, from, len, parent->recordMode);
+        if(err < 0)
+        {
+            return err;
+        }
+        simple_fifo_ring_commit(sharedRing, storedLen);
+        wake_up_interruptible_poll(&sharedRing->readWait, EPOLLIN | EPOLLRDNORM);
+        return 0;
+    }
+
+    list_for_each_entry_rcu(curFpd, readers, file_entry)
+    {
+        if(curFpd->detached)
+        {
+            continue;
+        }
+        /*
+         * Only a reader whose policy doesn't block the writers can lack room here, or a reader opened after the
+         * available space was computed with a ring too small for the data. The latter only receives the data written
+         * after it has been opened so it is skipped.
+         */
+        if(storedLen > simple_fifo_free_space(curFpd) && !simple_fifo_make_room(curFpd, storedLen))
+        {
+            continue;
+        }
+        if(firstRing == NULL)
+        {
+            err = simple_fifo_ring_fill(curFpd->ring, buf, from, len, parent->recordMode);
+            if(err < 0)
+            {
+                return err;
+            }
+            firstRing = curFpd->ring;
+        }
+        else
+        {
+            simple_fifo_ring_copy(curFpd->ring, firstRing, firstRing->writeOffset - storedLen, storedLen);
+        }
+        simple_fifo_ring_commit(curFpd->ring, storedLen);
+        wake_up_interruptible_poll(&curFpd->ring->readWait, EPOLLIN | EPOLLRDNORM);
+    }
+    return 0;
+}
+
+/*
+ * Frees a released file once no writer can reach it anymore.
+ */
+static void simple_fifo_free_rcu(struct rcu_head* rcu)
+{
+    struct file_private_data* fpd = container_of(rcu, struct file_private_data, rcu);
+
+    if(fpd->ring == &fpd->privateRing)
+    {
+        simple_fifo_ring_free(fpd->privateRing.ctrl, fpd->privateRing.data);
+    }
+    kmem_cache_free(fpd_cache, fpd);
+}
+
+/*
+ * Sets up the fifo of a minor and creates its device node once it is ready to be opened. The node is named after the
+ * minor unless a name is given. When owner is given, the cdev holds a reference on it until the cdev is deleted and
+ * the last file opened on it is released.
+ *
+ * The shared ring is not freed on failure, see simple_fifo_device_free().
+ */
+static int simple_fifo_device_init(struct simpleFifo_device_data* data, unsigned int minor, size_t capacity,
+                                   struct kobject* owner, const char* name)
+{
+    int err;
+
+    data->capacity = capacity;
+    data->broadcast = broadcast;
+    data->policy = slow_reader_policy;
+    data->recordMode = record_mode;
+    data->slotSize = slot_size;
+    if(data->broadcast)
+    {
+        err = simple_fifo_ring_alloc(&data->sharedRing, data->capacity, false);
+        if(err < 0)
+        {
+            return err;
+        }
+    }
+    mutex_init(&data->open_file_list_mutex);
+    INIT_LIST_HEAD(&data->opened_file_list);
+    hash_init(data->channels);
+    mutex_init(&data->write_mutex);
+    init_waitqueue_head(&data->writeWait);
+
+    cdev_init(&data->cdev, &simpleFifo_fops);
+    data->cdev.owner = THIS_MODULE;
+    if(owner != NULL)
+    {
+        cdev_set_parent(&data->cdev, owner);
+    }
+    err = cdev_add(&data->cdev, MKDEV(dev_major, minor), 1);
+    if(err < 0)
+    {
+        return err;
+    }
+
+    if(name != NULL)
+    {
+        data->dev = device_create(my_class, NULL, MKDEV(dev_major, minor), NULL, "simplefifo-%s", name);
+    }
+    else
+    {
+        data->dev = device_create(my_class, NULL, MKDEV(dev_major, minor), NULL, "simplefifo-%u", minor);
+    }
+    if(IS_ERR_OR_NULL(data->dev))
+    {
+        err = data->dev == NULL ? -ENOMEM : PTR_ERR(data->dev);
+        cdev_del(&data->cdev);
+        return err;
+    }
+    return 0;
+}
+
+/*
+ * Removes the device node of a fifo. The files already opened keep working until they are released.
+ */
+static void simple_fifo_device_exit(struct simpleFifo_device_data* data, unsigned int minor)
+{
+    device_destroy(my_class, MKDEV(dev_major, minor));
+    cdev_del(&data->cdev);
+}
+
+/*
+ * Frees what simple_fifo_device_init() allocated once no file of the fifo is opened anymore.
+ */
+static void simple_fifo_device_free(struct simpleFifo_device_data* data)
+{
+    if(data->broadcast)
+    {
+        kvfree(data->sharedRing.data);
+    }
+}
+
+/*
+ * A fifo created by a mkdir in /sys/kernel/config/simplefifo. Its files may outlive the rmdir so the instance is
+ * reference counted by kobj: the configfs item holds one reference and the cdev another one until the last file
+ * opened on it is released.
+ */
+struct simple_fifo_instance {
+    struct config_item item;
+    struct kobject kobj;
+    unsigned int minor;
+    struct simpleFifo_device_data data;
+};
+
+static struct simple_fifo_instance* to_simple_fifo_instance(struct config_item* item)
+{
+    return container_of(item, struct simple_fifo_instance, item);
+}
+
+static void simple_fifo_instance_release(struct kobject* kobj)
+{
+    struct simple_fifo_instance* instance = container_of(kobj, struct simple_fifo_instance, kobj);
+
+    simple_fifo_device_free(&instance->data);
+    ida_free(&simple_fifo_minors, instance->minor);
+    kfree(instance);
+}
+
+static struct kobj_type simple_fifo_instance_ktype = {
+        .release = &simple_fifo_instance_release
+};
+
+/*
+ * The attributes only apply to the files opened afterwards.
+ */
+static ssize_t simple_fifo_instance_fifo_size_show(struct config_item* item, char* page)
+{
+    return sprintf(page, "%zu\n", READ_ONCE(to_simple_fifo_instance(item)->data.capacity));
+}
+
+static ssize_t simple_fifo_instance_fifo_size_store(struct config_item* item, const char* page, size_t count)
+{
+    struct simpleFifo_device_data* data = &to_simple_fifo_instance(item)->data;
+    unsigned long long requestedSize;
+    size_t capacity;
+    int err;
+
+    err = kstrtoull(page, 0, &requestedSize);
+    if(err < 0)
+    {
+        return err;
+    }
+    /*
+     * The shared ring of a fifo in broadcast mode is allocated when the fifo is created.
+     */
+    if(data->broadcast)
+    {
+        return -EBUSY;
+    }
+    err = simple_fifo_check_size(requestedSize, &capacity);
+    if(err < 0)
+    {
+        return err;
+    }
+    WRITE_ONCE(data->capacity, capacity);
+    return count;
+}
+
+static ssize_t simple_fifo_instance_slow_reader_policy_show(struct config_item* item, char* page)
+{
+    return sprintf(page, "%u\n", READ_ONCE(to_simple_fifo_instance(item)->data.policy));
+}
+
+static ssize_t simple_fifo_instance_slow_reader_policy_store(struct config_item* item, const char* page, size_t count)
+{
+    struct simpleFifo_device_data* data = &to_simple_fifo_instance(item)->data;
+    unsigned int policy;
+    int err;
+
+    err = kstrtouint(page, 0, &policy);
+    if(err < 0)
+    {
+        return err;
+    }
+    err = simple_fifo_check_policy(data->broadcast, policy);
+    if(err < 0)
+    {
+        return err;
+    }
+    WRITE_ONCE(data->policy, policy);
+    return count;
+}
+
+static ssize_t simple_fifo_instance_record_mode_show(struct config_item* item, char* page)
+{
+    return sprintf(page, "%d\n", READ_ONCE(to_simple_fifo_instance(item)->data.recordMode));
+}
+
+/*
+ * The rings hold either records, fixed size elements or a byte stream so the framing can only be changed while no
+ * file is opened.
+ */
+static int simple_fifo_set_framing(struct simpleFifo_device_data* data, int recordMode, int slotSize)
+{
+    int err = 0;
+
+    mutex_lock(&data->write_mutex);
+    if(recordMode < 0)
+    {
+        recordMode = data->recordMode;
+    }
+    if(slotSize < 0)
+    {
+        slotSize = data->slotSize;
+    }
+    if(atomic_read(&data->openCount) != 0)
+    {
+        err = -EBUSY;
+    }
+    else
+    {
+        err = simple_fifo_check_framing(recordMode, slotSize);
+    }
+    if(err == 0)
+    {
+        WRITE_ONCE(data->recordMode, recordMode);
+        WRITE_ONCE(data->slotSize, slotSize);
+    }
+    mutex_unlock(&data->write_mutex);
+    return err;
+}
+
+static ssize_t simple_fifo_instance_record_mode_store(struct config_item* item, const char* page, size_t count)
+{
+    bool recordMode;
+    int err;
+
+    err = kstrtobool(page, &recordMode);
+    if(err < 0)
+    {
+        return err;
+    }
+    err = simple_fifo_set_framing(&to_simple_fifo_instance(item)->data, recordMode, -1);
+    return err < 0 ? err : count;
+}
+
+static ssize_t simple_fifo_instance_slot_size_show(struct config_item* item, char* page)
+{
+    return sprintf(page, "%u\n", READ_ONCE(to_simple_fifo_instance(item)->data.slotSize));
+}
+
+static ssize_t simple_fifo_instance_slot_size_store(struct config_item* item, const char* page, size_t count)
+{
+    unsigned int slotSize;
+    int err;
+
+    err = kstrtouint(page, 0, &slotSize);
+    if(err < 0)
+    {
+        return err;
+    }
+    if(slotSize > SIMPLE_FIFO_MAX_SLOT_SIZE)
+    {
+        return -EINVAL;
+    }
+    err = simple_fifo_set_framing(&to_simple_fifo_instance(item)->data, -1, slotSize);
+    return err < 0 ? err : count;
+}
+
+static ssize_t simple_fifo_instance_dev_show(struct config_item* item, char* page)
+{
+    return sprintf(page, "%d:%u\n", dev_major, to_simple_fifo_instance(item)->minor);
+}
+
+CONFIGFS_ATTR(simple_fifo_instance_, fifo_size);
+CONFIGFS_ATTR(simple_fifo_instance_, slow_reader_policy);
+CONFIGFS_ATTR(simple_fifo_instance_, record_mode);
+CONFIGFS_ATTR(simple_fifo_instance_, slot_size);
+CONFIGFS_ATTR_RO(simple_fifo_instance_, dev);
+
+static struct configfs_attribute* simple_fifo_instance_attrs[] = {
+        &simple_fifo_instance_attr_fifo_size,
+        &simple_fifo_instance_attr_slow_reader_policy,
+        &simple_fifo_instance_attr_record_mode,
+        &simple_fifo_instance_attr_slot_size,
+        &simple_fifo_instance_attr_dev,
+        NULL
+};
+
+static void simple_fifo_item_release(struct config_item* item)
+{
+    kobject_put(&to_simple_fifo_instance(item)->kobj);
+}
+
+static struct configfs_item_operations simple_fifo_instance_item_ops = {
+        .release = &simple_fifo_item_release
+};
+
+static const struct config_item_type simple_fifo_instance_type = {
+        .ct_item_ops = &simple_fifo_instance_item_ops,
+        .ct_attrs = simple_fifo_instance_attrs,
+        .ct_owner = THIS_MODULE
+};
+
+/*
+ * mkdir creates a fifo with the defaults of the module and its device node, named after the directory.
+ */
+static struct config_item* simple_fifo_make_item(struct config_group* group, const char* name)
+{
+    struct simple_fifo_instance* instance;
+    int minor;
+    int err;
+
+    minor = ida_alloc_range(&simple_fifo_minors, nb_fifos, SIMPLE_FIFO_MAX_FIFOS - 1, GFP_KERNEL);
+    if(minor < 0)
+    {
+        return ERR_PTR(minor);
+    }
+    instance = kzalloc(sizeof(struct simple_fifo_instance), GFP_KERNEL);
+    if(instance == NULL)
+    {
+        ida_free(&simple_fifo_minors, minor);
+        return ERR_PTR(-ENOMEM);
+    }
+    instance->minor = minor;
+    kobject_init(&instance->kobj, &simple_fifo_instance_ktype);
+    err = simple_fifo_device_init(&instance->data, minor, fifo_capacity, &instance->kobj, name);
+    if(err < 0)
+    {
+        kobject_put(&instance->kobj);
+        return ERR_PTR(err);
+    }
+    config_item_init_type_name(&instance->item, name, &simple_fifo_instance_type);
+    return &instance->item;
+}
+
+/*
+ * rmdir removes the device node. The fifo itself is freed once its last file is released.
+ */
+static void simple_fifo_drop_item(struct config_group* group, struct config_item* item)
+{
+    struct simple_fifo_instance* instance = to_simple_fifo_instance(item);
+
+    simple_fifo_device_exit(&instance->data, instance->minor);
+    config_item_put(item);
+}
+
+static struct configfs_group_operations simple_fifo_group_ops = {
+        .make_item = &simple_fifo_make_item,
+        .drop_item = &simple_fifo_drop_item
+};
+
+static const struct config_item_type simple_fifo_subsys_type = {
+        .ct_group_ops = &simple_fifo_group_ops,
+        .ct_owner = THIS_MODULE
+};
+
+static struct configfs_subsystem simple_fifo_subsys = {
+        .su_group = {
+                .cg_item = {
+                        .ci_namebuf = "simplefifo",
+                        .ci_type = &simple_fifo_subsys_type
+                }
+        }
+};
+
+static int __init simple_fifo_init(void)
+{
+	int err;
+	dev_t devNumber;
+    unsigned int minor;
+
+    err = simple_fifo_check_size(fifo_size, &fifo_capacity);
+    if(err < 0)
+    {
+        printk("Invalid fifo_size %lu\n", fifo_size);
+        return err;
+    }
+    err = simple_fifo_check_policy(broadcast, slow_reader_policy);
+    if(err < 0)
+    {
+        printk("Invalid slow_reader_policy %u\n", slow_reader_policy);
+        return err;
+    }
+    err = simple_fifo_check_framing(record_mode, slot_size);
+    if(err < 0)
+    {
+        printk("Invalid slot_size %u\n", slot_size);
+        return err;
+    }
+    if(nb_fifos == 0 || nb_fifos > SIMPLE_FIFO_MAX_FIFOS)
+    {
+        printk("Invalid nb_fifos %u\n", nb_fifos);
+        return -EINVAL;
+    }
+
+    fpd_cache = kmem_cache_create("simple_fifo_file", sizeof(struct file_private_data), 0,
+                                  SLAB_HWCACHE_ALIGN | SLAB_ACCOUNT, NULL);
+    if(fpd_cache == NULL)
+    {
+        return -ENOMEM;
+    }
+
+    simpleFifo_devices = kcalloc(nb_fifos, sizeof(struct simpleFifo_device_data), GFP_KERNEL);
+    if(simpleFifo_devices == NULL)
+    {
+        err = -ENOMEM;
+        goto destroy_fpd_cache;
+    }
+
+    /*
+     * All the minors are reserved upfront so that fifos can be created through configfs without reloading the module.
+     */
+	err = alloc_chrdev_region(&devNumber, 0, SIMPLE_FIFO_MAX_FIFOS, "simpleFifo");
+    if(err < 0)
+    {
+        goto free_devices;
+    }
+
+	dev_major = MAJOR(devNumber);
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,4,0)
+	my_class = class_create(THIS_MODULE, "simpleFifo");
+#else
+	my_class = class_create("simpleFifo");
+#endif
+    if(my_class == NULL)
+    {
+        err = -ENOMEM;
+        goto unregister_chrdev_region;
+    }
+
+    for(minor = 0; minor < nb_fifos; ++minor)
+    {
+        err = simple_fifo_device_init(&simpleFifo_devices[minor], minor, fifo_capacity, NULL, NULL);
+        if(err < 0)
+        {
+            simple_fifo_device_free(&simpleFifo_devices[minor]);
+            goto destroy_devices;
+        }
+    }
+
+    config_group_init(&simple_fifo_subsys.su_group);
+    mutex_init(&simple_fifo_subsys.su_mutex);
+    err = configfs_register_subsystem(&simple_fifo_subsys);
+    if(err < 0)
+    {
+        goto destroy_devices;
+    }
+
+    printk("Simple fifo registered\n");
+
+	return 0;
+
+destroy_devices:
+    while(minor-- > 0)
+    {
+        simple_fifo_device_exit(&simpleFifo_devices[minor], minor);
+        simple_fifo_device_free(&simpleFifo_devices[minor]);
+    }
+    class_destroy(my_class);
+unregister_chrdev_region:
+    unregister_chrdev_region(MKDEV(dev_major, 0), SIMPLE_FIFO_MAX_FIFOS);
+free_devices:
+    kfree(simpleFifo_devices);
+destroy_fpd_cache:
+    kmem_cache_destroy(fpd_cache);
+    return err;
+}
+
+static int simple_fifo_open(struct inode* inode, struct file* file)
+{
+    struct simpleFifo_device_data *data = container_of(inode->i_cdev, struct simpleFifo_device_data, cdev);
+
+    struct file_private_data* fpd = kmem_cache_zalloc(fpd_cache, GFP_KERNEL);
+    if(fpd == NULL)
+    {
+        return -ENOMEM;
+    }
+    /*
+     * A write only file never reads so it neither gets a ring nor limits the writers.
+     */
+    if((file->f_flags & O_ACCMODE) == O_WRONLY)
+    {
+        fpd->ring = NULL;
+    }
+    else if(data->broadcast)
+    {
+        fpd->ring = &data->sharedRing;
+    }
+    else
+    {
+        if(simple_fifo_ring_alloc(&fpd->privateRing, READ_ONCE(data->capacity), true) < 0)
+        {
+            kmem_cache_free(fpd_cache, fpd);
+            return -ENOMEM;
+        }
+        fpd->ring = &fpd->privateRing;
+    }
+    mutex_init(&fpd->read_mutex);
+    mutex_init(&fpd->map_mutex);
+    fpd->policy = READ_ONCE(data->policy);
+    /*
+     * The reads and writes honor IOCB_NOWAIT so io_uring can issue them inline instead of in a worker thread.
+     */
+    file->f_mode |= FMODE_NOWAIT;
+    fpd->parent = data;
+    atomic_inc(&data->openCount);
+    file->private_data = (void*)fpd;
+    if(fpd->ring == NULL)
+    {
+        return 0;
+    }
+    /*
+     * A new reader only receives the data written after it has been opened. The read offset must be set before
+     * the file is published to the writers. The shared ring is written meanwhile, so in broadcast mode both are done
+     * under write_mutex: a write in between would not be limited by the new reader and could overwrite the data at
+     * its read offset.
+     */
+    if(data->broadcast)
+    {
+        mutex_lock(&data->write_mutex);
+    }
+    fpd->readOffset = READ_ONCE(fpd->ring->writeOffset);
+    mutex_lock(&data->open_file_list_mutex);
+    list_add_rcu(&fpd->file_entry, &data->opened_file_list);
+    mutex_unlock(&data->open_file_list_mutex);
+    atomic_inc(&data->readersGeneration);
+    if(data->broadcast)
+    {
+        mutex_unlock(&data->write_mutex);
+    }
+    return 0;
+}
+
+/*
+ * Writes size bytes of user data, from buf or from the iterator when there is one. With nowait the writer sleeps
+ * neither for space, like for a file opened with O_NONBLOCK, nor for write_mutex.
+ */
+static ssize_t simple_fifo_do_write(struct file* file, char const __user* buf, struct iov_iter* from, size_t size,
+                                    bool nowait)
+{
+    size_t nbBytesToCopy;
+    size_t storedLen;
+    size_t written = 0;
+    size_t notFaultedIn;
+    long spaceGeneration;
+    int err;
+    struct simpleFifo_device_data* parent;
+    struct list_head* readers;
+
+    struct file_private_data *writenFilePd = (struct file_private_data *) file->private_data;
+    parent = writenFilePd->parent;
+    readers = simple_fifo_readers(writenFilePd);
+
+    if(size == 0)
+    {
+        return 0;
+    }
+
+    if(nowait)
+    {
+        if(!mutex_trylock(&parent->write_mutex))
+        {
+            return -EAGAIN;
+        }
+    }
+    else
+    {
+        mutex_lock(&parent->write_mutex);
+    }
+    /*
+     * The framing is only checked once write_mutex is held: the file may have been opened while it was being changed.
+     */
+    if(parent->recordMode && size > SIMPLE_FIFO_MAX_SIZE - SIMPLE_FIFO_RECORD_HEADER)
+    {
+        mutex_unlock(&parent->write_mutex);
+        return -EMSGSIZE;
+    }
+    /*
+     * Only whole elements are written. The space available is then always a multiple of their size.
+     */
+    if(parent->slotSize != 0 && (size & (parent->slotSize - 1)) != 0)
+    {
+        mutex_unlock(&parent->write_mutex);
+        return -EINVAL;
+    }
+    for(;;)
+    {
+        /*
+         * The generation is sampled before the available space is computed so that space freed in between is not
+         * missed by the wait below.
+         */
+        spaceGeneration = atomic_long_read(&parent->spaceGeneration);
+        rcu_read_lock();
+        if(parent->recordMode)
+        {
+            /*
+             * A record is stored whole or not at all. The readers are only checked one by one when the cached bound
+             * doesn't leave room for it.
+             */
+            if(parent->broadcast && SIMPLE_FIFO_RECORD_HEADER + size > simple_fifo_shared_ring(parent, readers)->capacity)
+            {
+                /*
+                 * The record must fit in the shared ring even when no reader limits it.
+                 */
+                err = -EMSGSIZE;
+            }
+            else if(simple_fifo_cached_writable(parent, readers, SIMPLE_FIFO_RECORD_HEADER + size) == SIMPLE_FIFO_RECORD_HEADER + size)
+            {
+                err = 1;
+            }
+            else
+            {
+                err = simple_fifo_record_writable(readers, SIMPLE_FIFO_RECORD_HEADER + size);
+            }
+            if(err < 0)
+            {
+                rcu_read_unlock();
+                mutex_unlock(&parent->write_mutex);
+                return err;
+            }
+            nbBytesToCopy = err != 0 ? size : 0;
+        }
+        else
+        {
+            nbBytesToCopy = simple_fifo_cached_writable(parent, readers, size - written);
+            /*
+             * A write of up to SIMPLE_FIFO_ATOMIC_SIZE bytes is stored in one go, never interleaved with the data of
+             * another writer. The rings are never smaller than that so the space eventually becomes available.
+             */
+            if(size <= SIMPLE_FIFO_ATOMIC_SIZE && nbBytesToCopy < size)
+            {
+                nbBytesToCopy = 0;
+            }
+        }
+        if(nbBytesToCopy == 0)
+        {
+            rcu_read_unlock();
+            mutex_unlock(&parent->write_mutex);
+            /*
+             * The part already stored is reported like on a pipe.
+             */
+            if(nowait || (file->f_flags & O_NONBLOCK))
+            {
+                return written != 0 ? written : -EAGAIN;
+            }
+            if(wait_event_interruptible(parent->writeWait, atomic_long_read(&parent->spaceGeneration) != spaceGeneration))
+            {
+                return written != 0 ? written : -ERESTARTSYS;
+            }
+        }
+        else
+        {
+            err = simple_fifo_store(parent, readers, buf, from, nbBytesToCopy);
+            rcu_read_unlock();
+            if(err == 0)
+            {
+                storedLen = parent->recordMode ? SIMPLE_FIFO_RECORD_HEADER + nbBytesToCopy : nbBytesToCopy;
+                parent->writable -= min(parent->writable, storedLen);
+                written += nbBytesToCopy;
+                /*
+                 * The iterator has already been advanced by the copy.
+                 */
+                if(from == NULL)
+                {
+                    buf += nbBytesToCopy;
+                }
+                if(written == size)
+                {
+                    break;
+                }
+                /*
+                 * The rest is written right away while write_mutex is still held. It is only released when the
+                 * writer has to wait, which is when a bigger write can be interleaved with other writers.
+                 */
+                continue;
+            }
+            /*
+             * The user pages must be faulted in outside of the RCU read side critical section. Nothing has been
+             * committed yet so the write is simply retried.
+             */
+            mutex_unlock(&parent->write_mutex);
+            if(nowait)
+            {
+                return written != 0 ? written : -EAGAIN;
+            }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,16,0)
+            notFaultedIn = from != NULL ? fault_in_iov_iter_readable(from, nbBytesToCopy) : fault_in_readable(buf, nbBytesToCopy);
+#else
+            notFaultedIn = from != NULL ? iov_iter_fault_in_readable(from, nbBytesToCopy) : fault_in_pages_readable(buf, nbBytesToCopy);
+#endif
+            if(notFaultedIn != 0)
+            {
+                return written != 0 ? written : -EFAULT;
+            }
+        }
+        mutex_lock(&parent->write_mutex);
+    }
+    mutex_unlock(&parent->write_mutex);
+    return written;
+}
+
+static ssize_t simple_fifo_write(struct file* file, char const* buf, size_t size, loff_t* offset)
+{
+    return simple_fifo_do_write(file, buf, NULL, size, false);
+}
+
+/*
+ * Publishes a range of the staging area like a write() of it. The data is copied from the mapping straight to the
+ * rings of the readers, without going through copy_from_user.
+ */
+static ssize_t simple_fifo_commit_staging(struct file* file, struct simple_fifo_commit const* commit)
+{
+    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
+    /*
+     * Pairs with the release in simple_fifo_mmap_staging(), stagingSize is set before the area is published.
+     */
+    uint8_t* staging = smp_load_acquire(&fpd->staging);
+    struct kvec kvec;
+    struct iov_iter from;
+
+    if(staging == NULL || commit->offset > fpd->stagingSize || commit->len > fpd->stagingSize - commit->offset)
+    {
+        return -EINVAL;
+    }
+    kvec.iov_base = staging + commit->offset;
+    kvec.iov_len = commit->len;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,1,0)
+    iov_iter_kvec(&from, ITER_SOURCE, &kvec, 1, commit->len);
+#else
+    iov_iter_kvec(&from, WRITE, &kvec, 1, commit->len);
+#endif
+    return simple_fifo_do_write(file, NULL, &from, commit->len, false);
+}
+
+/*
+ * Used by writev and io_uring: all the segments are stored under a single write_mutex section, and atomically when
+ * they add up to at most SIMPLE_FIFO_ATOMIC_SIZE bytes.
+ */
+static ssize_t simple_fifo_write_iter(struct kiocb* iocb, struct iov_iter* from)
+{
+    return simple_fifo_do_write(iocb->ki_filp, NULL, from, iov_iter_count(from), iocb->ki_flags & IOCB_NOWAIT);
+}
+
+/*
+ * Reads up to size bytes of pending data, to buf or to the iterator when there is one. With nowait the reader sleeps
+ * neither for data, like for a file opened with O_NONBLOCK, nor for read_mutex.
+ */
+static ssize_t simple_fifo_do_read(struct file* file, char __user* buf, struct iov_iter* to, size_t size, bool nowait)
+{
+    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
+    struct simpleFifo_device_data *parent = fpd->parent;
+    struct simple_fifo_ring *ring;
+    size_t writeOffset;
+    size_t readOffset;
+    size_t consumed;
+    size_t len;
+    size_t notFaultedIn;
+    bool mayFault = false;
+    __u32 recordLen;
+    int err;
+
+    if(nowait)
+    {
+        if(!mutex_trylock(&fpd->read_mutex))
+        {
+            return -EAGAIN;
+        }
+    }
+    else
+    {
+        mutex_lock(&fpd->read_mutex);
+    }
+    for(;;)
+    {
+        if(READ_ONCE(fpd->detached))
+        {
+            mutex_unlock(&fpd->read_mutex);
+            return 0;
+        }
+        /*
+         * The ring only changes under read_mutex, when the file is bound to a channel in broadcast mode.
+         */
+        ring = fpd->ring;
+        /*
+         * A writer dropping the oldest data moves the read offset before publishing the write offset. Loading the
+         * write offset first ensures that the pending data never exceeds the capacity of the ring.
+         */
+        writeOffset = smp_load_acquire(&ring->writeOffset);
+        readOffset = READ_ONCE(fpd->readOffset);
+        /*
+         * In broadcast mode a writer may have detached the file and wrapped the shared ring over its data since the
+         * check above. The pending data never exceeds the capacity otherwise.
+         */
+        if(writeOffset - readOffset > ring->capacity)
+        {
+            mutex_unlock(&fpd->read_mutex);
+            return 0;
+        }
+        if(writeOffset == readOffset)
+        {
+            mutex_unlock(&fpd->read_mutex);
+            if(nowait || (file->f_flags & O_NONBLOCK))
+            {
+                return -EAGAIN;
+            }
+            if(wait_event_interruptible(ring->readWait, simple_fifo_pending(fpd) != 0 || READ_ONCE(fpd->detached) ||
+                                        READ_ONCE(fpd->ring) != ring))
+            {
+                return -ERESTARTSYS;
+            }
+            mutex_lock(&fpd->read_mutex);
+            continue;
+        }
+        if(parent->recordMode)
+        {
+            simple_fifo_ring_copy_to_buf(ring, readOffset, (uint8_t*)&recordLen, SIMPLE_FIFO_RECORD_HEADER);
+            /*
+             * A writer dropping the oldest records may have overwritten the header while it was read. The barrier
+             * orders the read of the header before the check of the read offset.
+             */
+            if(fpd->policy == SIMPLE_FIFO_POLICY_DROP_OLDEST)
+            {
+                smp_rmb();
+                if(READ_ONCE(fpd->readOffset) != readOffset)
+                {
+                    continue;
+                }
+            }
+            /*
+             * The header is never trusted beyond the pending data, the read offset would otherwise be moved past the
+             * write offset.
+             */
+            if(writeOffset - readOffset < SIMPLE_FIFO_RECORD_HEADER ||
+               recordLen > writeOffset - readOffset - SIMPLE_FIFO_RECORD_HEADER)
+            {
+                mutex_unlock(&fpd->read_mutex);
+                return -EIO;
+            }
+            /*
+             * The record is left in the ring for a read with a bigger buffer.
+             */
+            if(recordLen > size)
+            {
+                mutex_unlock(&fpd->read_mutex);
+                return -EMSGSIZE;
+            }
+            len = recordLen;
+            consumed = SIMPLE_FIFO_RECORD_HEADER + len;
+        }
+        else
+        {
+            len = min(writeOffset - readOffset, size);
+            if(parent->slotSize != 0)
+            {
+                /*
+                 * Only whole elements are read.
+                 */
+                len = round_down(len, parent->slotSize);
+                if(len == 0)
+                {
+                    mutex_unlock(&fpd->read_mutex);
+                    return -EMSGSIZE;
+                }
+            }
+            consumed = len;
+        }
+        /*
+         * The pending data can't be overwritten until the read offset is released after the copy, unless the
+         * writers drop the oldest data of the file.
+         *
+         * Page faults are disabled so that read_mutex is never held across a fault: resizing the ring or changing
+         * the policy takes it with write_mutex held, and would otherwise stall every writer of the fifo behind the
+         * pages of this reader.
+         */
+        if(!mayFault)
+        {
+            pagefault_disable();
+        }
+        if(to != NULL)
+        {
+            err = simple_fifo_ring_copy_to_iter(ring, readOffset + consumed - len, to, len);
+        }
+        else
+        {
+            err = simple_fifo_ring_copy_to_user(ring, readOffset + consumed - len, buf, len);
+        }
+        if(!mayFault)
+        {
+            pagefault_enable();
+        }
+        if(err < 0)
+        {
+            /*
+             * Nothing has been released yet. The user pages are faulted in without read_mutex and the read is
+             * retried.
+             */
+            mutex_unlock(&fpd->read_mutex);
+            if(mayFault)
+            {
+                return -EFAULT;
+            }
+            if(nowait)
+            {
+                return -EAGAIN;
+            }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,16,0)
+            notFaultedIn = to != NULL ? fault_in_iov_iter_writeable(to, len) : fault_in_writeable(buf, len);
+#else
+            /*
+             * An iterator can't be faulted in for writing, its copy is retried with page faults enabled instead.
+             */
+            notFaultedIn = to != NULL ? 0 : fault_in_pages_writeable(buf, len);
+            mayFault = to != NULL;
+#endif
+            if(notFaultedIn != 0)
+            {
+                return -EFAULT;
+            }
+            mutex_lock(&fpd->read_mutex);
+            continue;
+        }
+        if(fpd->policy != SIMPLE_FIFO_POLICY_DROP_OLDEST)
+        {
+            simple_fifo_release_read_offset(fpd, readOffset + consumed);
+            break;
+        }
+        /*
+         * A writer may have dropped the data while it was copied. The read is then retried from the new read offset.
+         * The barrier orders the copy before the check of the read offset.
+         */
+        smp_mb();
+        if(cmpxchg(&fpd->readOffset, readOffset, readOffset + consumed) == readOffset)
+        {
+            break;
+        }
+        if(to != NULL)
+        {
+            iov_iter_revert(to, len);
+        }
+    }
+    simple_fifo_space_freed(parent);
+    mutex_unlock(&fpd->read_mutex);
+    return len;
+}
+
+static ssize_t simple_fifo_read(struct file* file, char* buf, size_t size, loff_t* offset)
+{
+    return simple_fifo_do_read(file, buf, NULL, size, false);
+}
+
+/*
+ * Used by readv and io_uring: the data is scattered across all the segments under a single read_mutex section. A
+ * record must fit in the segments as a whole.
+ */
+static ssize_t simple_fifo_read_iter(struct kiocb* iocb, struct iov_iter* to)
+{
+    return simple_fifo_do_read(iocb->ki_filp, NULL, to, iov_iter_count(to), iocb->ki_flags & IOCB_NOWAIT);
+}
+
+/*
+ * Replaces the ring of the opened file with a ring of the requested capacity. The pending data is moved to the
+ * beginning of the new ring. The shared ring of a device in broadcast mode can't be resized per file.
+ */
+static int simple_fifo_resize(struct file_private_data* fpd, __u64 requestedSize)
+{
+    struct simpleFifo_device_data *parent = fpd->parent;
+    struct simple_fifo_ring *ring = &fpd->privateRing;
+    struct simple_fifo_mmap_ctrl* newCtrl;
+    struct simple_fifo_mmap_ctrl* oldCtrl;
+    uint8_t* newData;
+    uint8_t* oldData;
+    size_t capacity;
+    size_t pending;
+    int err;
+
+    if(fpd->ring != ring)
+    {
+        return -EINVAL;
+    }
+    err = simple_fifo_check_size(requestedSize, &capacity);
+    if(err < 0)
+    {
+        return err;
+    }
+    newCtrl = simple_fifo_ctrl_alloc(capacity);
+    if(newCtrl == NULL)
+    {
+        return -ENOMEM;
+    }
+    newData = (uint8_t*)newCtrl + PAGE_SIZE;
+
+    /*
+     * The writers and the readers of the file are both excluded while the ring is replaced. A mapped ring is kept.
+     */
+    mutex_lock(&parent->write_mutex);
+    mutex_lock(&fpd->read_mutex);
+    mutex_lock(&fpd->map_mutex);
+    pending = ring->writeOffset - fpd->readOffset;
+    if(fpd->mapped || pending > capacity)
+    {
+        mutex_unlock(&fpd->map_mutex);
+        mutex_unlock(&fpd->read_mutex);
+        mutex_unlock(&parent->write_mutex);
+        vfree(newCtrl);
+        return -EBUSY;
+    }
+    simple_fifo_ring_copy_to_buf(ring, fpd->readOffset, newData, pending);
+    newCtrl->writeOffset = pending;
+    newCtrl->detached = fpd->detached;
+    oldCtrl = ring->ctrl;
+    oldData = ring->data;
+    ring->ctrl = newCtrl;
+    ring->data = newData;
+    ring->capacity = capacity;
+    ring->writeOffset = pending;
+    fpd->readOffset = 0;
+    atomic_inc(&parent->readersGeneration);
+    mutex_unlock(&fpd->map_mutex);
+    mutex_unlock(&fpd->read_mutex);
+    mutex_unlock(&parent->write_mutex);
+    simple_fifo_space_freed(parent);
+
+    simple_fifo_ring_free(oldCtrl, oldData);
+    return 0;
+}
+
+/*
+ * The writers and the reader of the file are both excluded while the policy is changed so that they never see it
+ * change in the middle of an operation. The writers are woken up as the file may no longer block them.
+ */
+static int simple_fifo_set_policy(struct file_private_data* fpd, __u32 policy)
+{
+    struct simpleFifo_device_data *parent = fpd->parent;
+    int err;
+
+    err = simple_fifo_check_policy(parent->broadcast, policy);
+    if(err < 0)
+    {
+        return err;
+    }
+    mutex_lock(&parent->write_mutex);
+    mutex_lock(&fpd->read_mutex);
+    mutex_lock(&fpd->map_mutex);
+    if(fpd->mapped && policy == SIMPLE_FIFO_POLICY_DROP_OLDEST)
+    {
+        err = -EBUSY;
+    }
+    else
+    {
+        /*
+         * The writers may have moved the read offset while the oldest data was dropped, the mirror is brought up to
+         * date now that only the reader moves it.
+         */
+        if(fpd->ring != NULL && fpd->ring->ctrl != NULL)
+        {
+            WRITE_ONCE(fpd->ring->ctrl->readOffset, fpd->readOffset);
+        }
+        WRITE_ONCE(fpd->policy, policy);
+        atomic_inc(&parent->readersGeneration);
+    }
+    mutex_unlock(&fpd->map_mutex);
+    mutex_unlock(&fpd->read_mutex);
+    mutex_unlock(&parent->write_mutex);
+    if(err < 0)
+    {
+        return err;
+    }
+    simple_fifo_space_freed(parent);
+    return 0;
+}
+
+/*
+ * Releases count bytes of pending data as if they had been read, see SIMPLE_FIFO_IOC_CONSUME. The writers can't move
+ * the read offset at the same time since the policy can't be SIMPLE_FIFO_POLICY_DROP_OLDEST. In record mode the count
+ * must end on a record boundary so that the next read finds a header.
+ */
+static int simple_fifo_consume(struct file_private_data* fpd, __u64 count)
+{
+    struct simpleFifo_device_data *parent = fpd->parent;
+    size_t readOffset;
+
+    if(fpd->ring == NULL)
+    {
+        return -EINVAL;
+    }
+    mutex_lock(&fpd->read_mutex);
+    readOffset = fpd->readOffset;
+    if(fpd->policy == SIMPLE_FIFO_POLICY_DROP_OLDEST || count > smp_load_acquire(&fpd->ring->writeOffset) - readOffset ||
+       (parent->slotSize != 0 && (count & (parent->slotSize - 1)) != 0) ||
+       (parent->recordMode && simple_fifo_record_boundary(fpd->ring, readOffset, readOffset + count) != readOffset + count))
+    {
+        mutex_unlock(&fpd->read_mutex);
+        return -EINVAL;
+    }
+    simple_fifo_release_read_offset(fpd, readOffset + count);
+    mutex_unlock(&fpd->read_mutex);
+    simple_fifo_space_freed(parent);
+    return 0;
+}
+
+/*
+ * Returns the channel of the fifo with the given name, creating it if needed, and takes a reference on it. Must be
+ * called with open_file_list_mutex held.
+ */
+static struct simple_fifo_channel* simple_fifo_channel_get(struct simpleFifo_device_data* parent, const char* name)
+{
+    struct simple_fifo_channel* channel;
+    size_t len = strlen(name);
+    u32 hash = jhash(name, len, 0);
+
+    hash_for_each_possible(parent->channels, channel, node, hash)
+    {
+        if(strcmp(channel->name, name) == 0)
+        {
+            ++channel->refCount;
+            return channel;
+        }
+    }
+    channel = kzalloc(sizeof(struct simple_fifo_channel), GFP_KERNEL);
+    if(channel == NULL)
+    {
+        return ERR_PTR(-ENOMEM);
+    }
+    if(parent->broadcast && simple_fifo_ring_alloc(&channel->ring, parent->capacity, false) < 0)
+    {
+        kfree(channel);
+        return ERR_PTR(-ENOMEM);
+    }
+    memcpy(channel->name, name, len + 1);
+    channel->refCount = 1;
+    INIT_LIST_HEAD(&channel->opened_file_list);
+    hash_add(parent->channels, &channel->node, hash);
+    return channel;
+}
+
+/*
+ * Must be called with open_file_list_mutex held. Nothing can reach a channel without files bound to it.
+ */
+static void simple_fifo_channel_put(struct simple_fifo_channel* channel)
+{
+    if(channel == NULL || --channel->refCount != 0)
+    {
+        return;
+    }
+    hash_del(&channel->node);
+    /*
+     * Only the files bound to the channel use its ring, all of them are gone.
+     */
+    if(channel->ring.data != NULL)
+    {
+        kvfree(channel->ring.data);
+    }
+    kfree(channel);
+}
+
+/*
+ * Moves the file from the readers of the device to the ones of the channel. The file can't be added to the new list
+ * until no writer walks over it in the old one anymore. In broadcast mode it also moves to the ring of the channel. The
+ * whole move is then done under write_mutex and read_mutex: once off the list of the device, the file no longer limits
+ * the writers of its old ring, which could overwrite the data a read in progress is copying, and the write offset of
+ * the new ring must not move until the file limits its writers.
+ */
+static int simple_fifo_bind_channel(struct file_private_data* fpd, struct simple_fifo_channel_name const* channelName)
+{
+    struct simpleFifo_device_data *parent = fpd->parent;
+    struct simple_fifo_channel* channel;
+    bool moveRing = parent->broadcast && fpd->ring != NULL;
+
+    if(channelName->name[0] == '\0' ||
+       strnlen(channelName->name, SIMPLE_FIFO_CHANNEL_NAME_LEN) == SIMPLE_FIFO_CHANNEL_NAME_LEN)
+    {
+        return -EINVAL;
+    }
+    if(moveRing)
+    {
+        mutex_lock(&parent->write_mutex);
+        mutex_lock(&fpd->read_mutex);
+    }
+    mutex_lock(&parent->open_file_list_mutex);
+    channel = fpd->channel != NULL ? ERR_PTR(-EBUSY) : simple_fifo_channel_get(parent, channelName->name);
+    if(IS_ERR(channel))
+    {
+        mutex_unlock(&parent->open_file_list_mutex);
+        if(moveRing)
+        {
+            mutex_unlock(&fpd->read_mutex);
+            mutex_unlock(&parent->write_mutex);
+        }
+        return PTR_ERR(channel);
+    }
+    if(fpd->ring != NULL)
+    {
+        list_del_rcu(&fpd->file_entry);
+    }
+    WRITE_ONCE(fpd->channel, channel);
+    mutex_unlock(&parent->open_file_list_mutex);
+
+    if(fpd->ring != NULL)
+    {
+        synchronize_rcu();
+        if(moveRing)
+        {
+            WRITE_ONCE(fpd->ring, &channel->ring);
+            fpd->readOffset = READ_ONCE(channel->ring.writeOffset);
+        }
+        mutex_lock(&parent->open_file_list_mutex);
+        list_add_rcu(&fpd->file_entry, &channel->opened_file_list);
+        mutex_unlock(&parent->open_file_list_mutex);
+        atomic_inc(&parent->readersGeneration);
+        if(moveRing)
+        {
+            mutex_unlock(&fpd->read_mutex);
+            mutex_unlock(&parent->write_mutex);
+            /*
+             * A reader of the file waiting on the ring of the device must go to sleep again on the one of the channel.
+             */
+            wake_up_interruptible_poll(&parent->sharedRing.readWait, EPOLLIN | EPOLLRDNORM);
+        }
+        /*
+         * The file no longer limits the writers of the device.
+         */
+        simple_fifo_space_freed(parent);
+    }
+    return 0;
+}
+
+static long simple_fifo_ioctl(struct file* file, unsigned int cmd, unsigned long arg)
+{
+    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
+    void __user* userArg = (void __user*)arg;
+    __u64 fifoSize;
+    __u32 policy;
+    struct simple_fifo_channel_name channelName;
+    __u64 count;
+    struct simple_fifo_commit commit;
+
+    switch(cmd)
+    {
+        case SIMPLE_FIFO_IOC_GET_SIZE:
+            if(fpd->ring == NULL)
+            {
+                return -EINVAL;
+            }
+            fifoSize = fpd->ring->capacity;
+            if(copy_to_user(userArg, &fifoSize, sizeof(fifoSize)))
+            {
+                return -EFAULT;
+            }
+            return 0;
+        case SIMPLE_FIFO_IOC_SET_SIZE:
+            if(copy_from_user(&fifoSize, userArg, sizeof(fifoSize)))
+            {
+                return -EFAULT;
+            }
+            return simple_fifo_resize(fpd, fifoSize);
+        case SIMPLE_FIFO_IOC_GET_POLICY:
+            policy = fpd->policy;
+            if(copy_to_user(userArg, &policy, sizeof(policy)))
+            {
+                return -EFAULT;
+            }
+            return 0;
+        case SIMPLE_FIFO_IOC_SET_POLICY:
+            if(copy_from_user(&policy, userArg, sizeof(policy)))
+            {
+                return -EFAULT;
+            }
+            return simple_fifo_set_policy(fpd, policy);
+        case SIMPLE_FIFO_IOC_BIND_CHANNEL:
+            if(copy_from_user(&channelName, userArg, sizeof(channelName)))
+            {
+                return -EFAULT;
+            }
+            return simple_fifo_bind_channel(fpd, &channelName);
+        case SIMPLE_FIFO_IOC_CONSUME:
+            if(copy_from_user(&count, userArg, sizeof(count)))
+            {
+                return -EFAULT;
+            }
+            return simple_fifo_consume(fpd, count);
+        case SIMPLE_FIFO_IOC_COMMIT:
+            if(copy_from_user(&commit, userArg, sizeof(commit)))
+            {
+                return -EFAULT;
+            }
+            return simple_fifo_commit_staging(file, &commit);
+        default:
+            return -ENOTTY;
+    }
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+/*
+ * Publishes or consumes a batch of messages, each one going through the same path as a write() or a read(). Returns
+ * the number of messages transferred, or the error which stopped the batch when there is none.
+ */
+static int simple_fifo_uring_batch(struct file* file, struct simple_fifo_uring_cmd const* cmd, bool publish, bool nowait)
+{
+    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
+    struct simple_fifo_msg __user* msgs = u64_to_user_ptr(cmd->addr);
+    struct simple_fifo_msg msg;
+    unsigned int done;
+    ssize_t rv = 0;
+    __u32 len;
+
+    for(done = 0; done < cmd->nr; ++done)
+    {
+        if(copy_from_user(&msg, &msgs[done], sizeof(msg)))
+        {
+            rv = -EFAULT;
+            break;
+        }
+        if(publish)
+        {
+            if(!fpd->parent->recordMode && msg.len > SIMPLE_FIFO_ATOMIC_SIZE)
+            {
+                rv = -EMSGSIZE;
+                break;
+            }
+            rv = simple_fifo_do_write(file, u64_to_user_ptr(msg.addr), NULL, msg.len, nowait);
+            if(rv < 0)
+            {
+                break;
+            }
+            continue;
+        }
+        /*
+         * Only the first message is waited for, the batch ends with the data pending.
+         */
+        rv = simple_fifo_do_read(file, u64_to_user_ptr(msg.addr), NULL, msg.len, nowait || done != 0);
+        if(rv <= 0)
+        {
+            break;
+        }
+        len = rv;
+        if(copy_to_user(&msgs[done].len, &len, sizeof(len)))
+        {
+            rv = -EFAULT;
+            break;
+        }
+    }
+    return done != 0 ? done : rv;
+}
+
+/*
+ * Runs a SIMPLE_FIFO_URING_CMD_* command. The command completes synchronously. When io_uring issues it inline nothing
+ * sleeps and -EAGAIN makes io_uring issue it again from a worker thread.
+ */
+static int simple_fifo_uring_cmd(struct io_uring_cmd* ioucmd, unsigned int issueFlags)
+{
+    struct file_private_data *fpd = (struct file_private_data*)ioucmd->file->private_data;
+    struct simple_fifo_uring_cmd cmd;
+
+    /*
+     * The SQE may be in memory shared with the user, it is read once.
+     */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,5,0)
+    memcpy(&cmd, io_uring_sqe_cmd(ioucmd->sqe), sizeof(cmd));
+#else
+    memcpy(&cmd, ioucmd->cmd, sizeof(cmd));
+#endif
+    switch(ioucmd->cmd_op)
+    {
+        case SIMPLE_FIFO_URING_CMD_PUBLISH:
+        case SIMPLE_FIFO_URING_CMD_CONSUME:
+            /*
+             * The access mode of the file is enforced here like the VFS does for write() and read().
+             */
+            if(!(ioucmd->file->f_mode & (ioucmd->cmd_op == SIMPLE_FIFO_URING_CMD_PUBLISH ? FMODE_WRITE : FMODE_READ)))
+            {
+                return -EBADF;
+            }
+            if(cmd.flags != 0 || cmd.nr > INT_MAX)
+            {
+                return -EINVAL;
+            }
+            return simple_fifo_uring_batch(ioucmd->file, &cmd, ioucmd->cmd_op == SIMPLE_FIFO_URING_CMD_PUBLISH,
+                                           issueFlags & IO_URING_F_NONBLOCK);
+        case SIMPLE_FIFO_URING_CMD_OCCUPANCY:
+            if(!(ioucmd->file->f_mode & FMODE_READ))
+            {
+                return -EBADF;
+            }
+            return simple_fifo_pending(fpd);
+        default:
+            return -ENOTTY;
+    }
+}
+#endif
+
+/*
+ * Allocates the staging area of a writer and maps it shared, see SIMPLE_FIFO_IOC_COMMIT. A private mapping would
+ * never be seen by the module once written.
+ */
+static int simple_fifo_mmap_staging(struct file* file, struct vm_area_struct* vma)
+{
+    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
+    size_t size = vma->vm_end - vma->vm_start;
+    uint8_t* staging;
+    int err;
+
+    if(!(file->f_mode & FMODE_WRITE) || !(vma->vm_flags & VM_SHARED) || size > SIMPLE_FIFO_MAX_SIZE)
+    {
+        return -EINVAL;
+    }
+    mutex_lock(&fpd->map_mutex);
+    if(fpd->staging != NULL)
+    {
+        mutex_unlock(&fpd->map_mutex);
+        return -EBUSY;
+    }
+    staging = vmalloc_user(size);
+    if(staging == NULL)
+    {
+        mutex_unlock(&fpd->map_mutex);
+        return -ENOMEM;
+    }
+    err = remap_vmalloc_range(vma, staging, 0);
+    if(err < 0)
+    {
+        mutex_unlock(&fpd->map_mutex);
+        vfree(staging);
+        return err;
+    }
+    fpd->stagingSize = size;
+    smp_store_release(&fpd->staging, staging);
+    mutex_unlock(&fpd->map_mutex);
+    return 0;
+}
+
+/*
+ * Maps the control page and the data of the private ring of the file read only, see struct simple_fifo_mmap_ctrl. The
+ * ring is then kept until the file is released.
+ */
+static int simple_fifo_mmap(struct file* file, struct vm_area_struct* vma)
+{
+    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
+    struct simple_fifo_ring *ring = &fpd->privateRing;
+    int err;
+
+    if(vma->vm_pgoff == SIMPLE_FIFO_MMAP_STAGING_OFFSET >> PAGE_SHIFT)
+    {
+        return simple_fifo_mmap_staging(file, vma);
+    }
+
+    /*
+     * The ring is read back by the driver, for the record headers and as the source of the copies to the other
+     * readers, so the mapping can't be made writable later with mprotect() either.
+     */
+    if(fpd->ring != ring || (vma->vm_flags & VM_WRITE) || vma->vm_pgoff != 0)
+    {
+        return -EINVAL;
+    }
+    mutex_lock(&fpd->map_mutex);
+    if(fpd->policy == SIMPLE_FIFO_POLICY_DROP_OLDEST || vma->vm_end - vma->vm_start != PAGE_SIZE + ring->capacity)
+    {
+        mutex_unlock(&fpd->map_mutex);
+        return -EINVAL;
+    }
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+    vm_flags_clear(vma, VM_MAYWRITE);
+#else
+    vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+    err = remap_vmalloc_range(vma, ring->ctrl, 0);
+    if(err == 0)
+    {
+        fpd->mapped = true;
+    }
+    mutex_unlock(&fpd->map_mutex);
+    return err;
+}
+
+/*
+ * A file is readable when its ring has pending data and writable when every blocking reader has room for at least one
+ * byte, or for a one byte record in record mode. A detached file reports a hang up.
+ * Readers of a ring are woken on each write and writers each time a reader frees space, which is what edge
+ * triggered epoll expects.
+ */
+static __poll_t simple_fifo_poll(struct file* file, poll_table* wait)
+{
+    struct file_private_data *fpd = (struct file_private_data*)file->private_data;
+    struct simpleFifo_device_data *parent = fpd->parent;
+    struct list_head* readers = simple_fifo_readers(fpd);
+    __poll_t mask = 0;
+    bool writable;
+
+    /*
+     * A write only file is never readable.
+     */
+    if(fpd->ring != NULL)
+    {
+        poll_wait(file, &fpd->ring->readWait, wait);
+        if(READ_ONCE(fpd->detached))
+        {
+            mask |= EPOLLHUP;
+        }
+        else if(simple_fifo_pending(fpd) != 0)
+        {
+            mask |= EPOLLIN | EPOLLRDNORM;
+        }
+    }
+    poll_wait(file, &parent->writeWait, wait);
+
+    rcu_read_lock();
+    if(parent->recordMode)
+    {
+        writable = simple_fifo_record_writable(readers, SIMPLE_FIFO_RECORD_HEADER + 1) > 0;
+    }
+    else
+    {
+        writable = simple_fifo_writable(readers, 1) != 0;
+    }
+    rcu_read_unlock();
+    if(writable)
+    {
+        mask |= EPOLLOUT | EPOLLWRNORM;
+    }
+    return mask;
+}
+
+static int simple_fifo_release(struct inode* inode, struct file* file)
+{
+    struct file_private_data* fpd = (struct file_private_data*)file->private_data;
+    struct simpleFifo_device_data* parent = fpd->parent;
+
+    atomic_dec(&parent->openCount);
+    /*
+     * The file is only released once unmapped, the staging area is no longer used.
+     */
+    if(fpd->staging != NULL)
+    {
+        vfree(fpd->staging);
+    }
+    /*
+     * Nothing can reach a write only file which is not bound to a channel.
+     */
+    if(fpd->ring != NULL || fpd->channel != NULL)
+    {
+        mutex_lock(&parent->open_file_list_mutex);
+        if(fpd->ring != NULL)
+        {
+            list_del_rcu(&fpd->file_entry);
+        }
+        simple_fifo_channel_put(fpd->channel);
+        mutex_unlock(&parent->open_file_list_mutex);
+    }
+    if(fpd->ring == NULL)
+    {
+        kmem_cache_free(fpd_cache, fpd);
+        return 0;
+    }
+    /*
+     * A writer may still be walking over the file, it is only freed after a grace period.
+     */
+    call_rcu(&fpd->rcu, simple_fifo_free_rcu);
+    simple_fifo_space_freed(parent);
+    return 0;
+};
+
+static void __exit simple_fifo_exit(void)
+{
+    unsigned int minor;
+
+    /*
+     * The fifos created through configfs hold a reference on the module so they are all gone at this point.
+     */
+    configfs_unregister_subsystem(&simple_fifo_subsys);
+    for(minor = 0; minor < nb_fifos; ++minor)
+    {
+        simple_fifo_device_exit(&simpleFifo_devices[minor], minor);
+        simple_fifo_device_free(&simpleFifo_devices[minor]);
+    }
+    class_destroy(my_class);
+
+    unregister_chrdev_region(MKDEV(dev_major, 0), SIMPLE_FIFO_MAX_FIFOS);
 
-    unregister_chrdev_region(MKDEV(dev_major, 0), MINORMASK);
+    /*
+     * Waits for the released files to be freed before the module code and their cache go away.
+     */
+    rcu_barrier();
+    kfree(simpleFifo_devices);
+    kmem_cache_destroy(fpd_cache);
+    ida_destroy(&simple_fifo_minors);
 
     printk("Simple fifo unregistered\n");
 }
@@ -0,0 +1,123 @@
+#ifndef SIMPLE_FIFO_H
+#define SIMPLE_FIFO_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define SIMPLE_FIFO_IOC_MAGIC 0xF1
+
+/*
+ * A write of up to SIMPLE_FIFO_ATOMIC_SIZE bytes is stored in one go, never interleaved with the data of another
+ * writer, like a write of up to PIPE_BUF bytes on a pipe. It is also the minimum capacity of a ring.
+ */
+#define SIMPLE_FIFO_ATOMIC_SIZE 4096
+
+/*
+ * Capacity in bytes of the ring of the opened file. The capacity is rounded up to a power of two and must be
+ * between 4KiB and 64MiB. Shrinking the ring below the amount of pending data fails with EBUSY.
+ */
+#define SIMPLE_FIFO_IOC_GET_SIZE _IOR(SIMPLE_FIFO_IOC_MAGIC, 0, __u64)
+#define SIMPLE_FIFO_IOC_SET_SIZE _IOW(SIMPLE_FIFO_IOC_MAGIC, 1, __u64)
+
+/*
+ * What a writer does with a reader whose ring has no room left for the data being written:
+ * - BLOCK: the writer waits for the reader, no data is lost.
+ * - DROP_OLDEST: the oldest pending data of the reader is overwritten.
+ * - DROP_NEWEST: the reader doesn't receive the data. Not supported in broadcast mode.
+ * - DETACH: the reader stops receiving data, its pending data is dropped and reads return end of file.
+ *
+ * The policy of an opened file defaults to the slow_reader_policy module parameter.
+ */
+#define SIMPLE_FIFO_POLICY_BLOCK 0
+#define SIMPLE_FIFO_POLICY_DROP_OLDEST 1
+#define SIMPLE_FIFO_POLICY_DROP_NEWEST 2
+#define SIMPLE_FIFO_POLICY_DETACH 3
+
+#define SIMPLE_FIFO_IOC_GET_POLICY _IOR(SIMPLE_FIFO_IOC_MAGIC, 2, __u32)
+#define SIMPLE_FIFO_IOC_SET_POLICY _IOW(SIMPLE_FIFO_IOC_MAGIC, 3, __u32)
+
+/*
+ * Binds the opened file to a named channel of the fifo. The file then only receives the data written by the files bound
+ * to the same channel, and its writes only reach them. The name is NUL terminated and 1 to 31 characters long. A file
+ * can only be bound once. In broadcast mode each channel has its own shared ring, which a file only reads from once it
+ * is bound, so it should be bound before it is polled.
+ */
+#define SIMPLE_FIFO_CHANNEL_NAME_LEN 32
+
+struct simple_fifo_channel_name {
+    char name[SIMPLE_FIFO_CHANNEL_NAME_LEN];
+};
+
+#define SIMPLE_FIFO_IOC_BIND_CHANNEL _IOW(SIMPLE_FIFO_IOC_MAGIC, 4, struct simple_fifo_channel_name)
+
+/*
+ * The ring of a file opened for reading can be mapped read only to consume its data in place, without any copy. The
+ * mapping starts at offset 0 and spans a page holding a struct simple_fifo_mmap_ctrl followed by the capacity bytes
+ * of the ring. The offsets are free running: the data at an offset is at offset & (capacity - 1) in the ring, wrapping
+ * around its end. The data between readOffset and writeOffset can be read once writeOffset has been loaded with
+ * acquire semantics, and is released to the writers with SIMPLE_FIFO_IOC_CONSUME.
+ *
+ * Mapping is not supported in broadcast mode nor with SIMPLE_FIFO_POLICY_DROP_OLDEST, whose writers would overwrite
+ * the data while it is read in place, and a mapped ring can't be resized.
+ */
+struct simple_fifo_mmap_ctrl {
+    __u64 writeOffset;
+    __u64 readOffset;
+    __u64 capacity;
+    __u32 detached;
+    __u32 reserved;
+};
+
+/*
+ * Releases the given number of bytes at the read offset of the opened file, as if they had been read. The count must
+ * not exceed the pending data, must be a multiple of the element size when slot_size is set and must end on a record
+ * boundary in record mode.
+ */
+#define SIMPLE_FIFO_IOC_CONSUME _IOW(SIMPLE_FIFO_IOC_MAGIC, 5, __u64)
+
+/*
+ * A file opened for writing can map a staging area shared with the module at offset SIMPLE_FIFO_MMAP_STAGING_OFFSET.
+ * Its size is the length of the mapping, up to 64MiB, and it can only be mapped once per file. The writer reserves a
+ * range of it, fills the payload in place and publishes it with SIMPLE_FIFO_IOC_COMMIT, which behaves like a write()
+ * of the range without copying it from the user. The range can be reused as soon as the ioctl returns.
+ *
+ * The ioctl returns the number of bytes published, which is only less than len when the write would have been short.
+ */
+#define SIMPLE_FIFO_MMAP_STAGING_OFFSET 0x40000000
+
+struct simple_fifo_commit {
+    __u64 offset;
+    __u64 len;
+};
+
+#define SIMPLE_FIFO_IOC_COMMIT _IOW(SIMPLE_FIFO_IOC_MAGIC, 6, struct simple_fifo_commit)
+
+/*
+ * Batched operations submitted with IORING_OP_URING_CMD. The cmd_op of the SQE is one of the commands below and its
+ * command area holds a struct simple_fifo_uring_cmd, which fits in a regular 64 bytes SQE.
+ * - PUBLISH writes the nr messages described by the array at addr, each one like a write() of its own. The messages
+ *   of a byte stream are limited to SIMPLE_FIFO_ATOMIC_SIZE bytes so that they are never split.
+ * - CONSUME reads up to nr messages, one record each in record mode, in the buffers described by the array at addr
+ *   and sets their len to the length read. Only the first message is waited for.
+ * - OCCUPANCY completes with the number of bytes pending for the file.
+ * PUBLISH and CONSUME complete with the number of messages transferred, or with the error which stopped the batch
+ * when there is none. flags must be 0. Like write() and read(), PUBLISH needs a file opened for writing and CONSUME
+ * and OCCUPANCY one opened for reading, EBADF is returned otherwise.
+ */
+#define SIMPLE_FIFO_URING_CMD_PUBLISH 0
+#define SIMPLE_FIFO_URING_CMD_CONSUME 1
+#define SIMPLE_FIFO_URING_CMD_OCCUPANCY 2
+
+struct simple_fifo_msg {
+    __u64 addr;
+    __u32 len;
+    __u32 reserved;
+};
+
+struct simple_fifo_uring_cmd {
+    __u64 addr;
+    __u32 nr;
+    __u32 flags;
+};
+
+#endif //SIMPLE_FIFO_H
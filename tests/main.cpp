@@ -51,6 +51,51 @@ TEST_CASE("Init module", "[init_module]")
         CHECK(test_init_module_device_create_fail() == 0);
         check_easyMock();
     }
+    SECTION("Invalid fifo_size parameter")
+    {
+        CHECK(test_init_module_invalid_fifo_size() == 0);
+        check_easyMock();
+    }
+    SECTION("Invalid slow_reader_policy parameter")
+    {
+        CHECK(test_init_module_invalid_slow_reader_policy() == 0);
+        check_easyMock();
+    }
+    SECTION("Invalid slot_size")
+    {
+        CHECK(test_init_module_invalid_slot_size() == 0);
+        check_easyMock();
+    }
+    SECTION("Kmem_cache_create fails")
+    {
+        CHECK(test_init_module_fpd_cache_create_fail() == 0);
+        check_easyMock();
+    }
+    SECTION("Invalid nb_fifos")
+    {
+        CHECK(test_init_module_invalid_nb_fifos() == 0);
+        check_easyMock();
+    }
+    SECTION("Device array allocation fails")
+    {
+        CHECK(test_init_module_kcalloc_fail() == 0);
+        check_easyMock();
+    }
+    SECTION("Two fifos")
+    {
+        CHECK(test_init_module_two_fifos() == 0);
+        check_easyMock();
+    }
+    SECTION("Second fifo fails")
+    {
+        CHECK(test_init_module_second_fifo_fails() == 0);
+        check_easyMock();
+    }
+    SECTION("Configfs registration fails")
+    {
+        CHECK(test_init_module_configfs_register_fail() == 0);
+        check_easyMock();
+    }
 }
 
 TEST_CASE("Open file", "[open]")
@@ -61,9 +106,24 @@ TEST_CASE("Open file", "[open]")
         CHECK(test_simple_fifo_open() == 0);
         check_easyMock();
     }
-    SECTION("Devm_kzalloc fails")
+    SECTION("Private data allocation fails")
     {
-        CHECK(test_simple_fifo_open_devm_kzalloc_fail() == 0);
+        CHECK(test_simple_fifo_open_alloc_fail() == 0);
+        check_easyMock();
+    }
+    SECTION("Kvmalloc fails")
+    {
+        CHECK(test_simple_fifo_open_kvmalloc_fail() == 0);
+        check_easyMock();
+    }
+    SECTION("Open broadcast fifo")
+    {
+        CHECK(test_simple_fifo_open_broadcast() == 0);
+        check_easyMock();
+    }
+    SECTION("Open write only")
+    {
+        CHECK(test_simple_fifo_open_write_only() == 0);
         check_easyMock();
     }
 }
@@ -101,16 +161,46 @@ TEST_CASE("Write file", "[write]")
         CHECK(test_simple_fifo_write_copy_from_user_fails() == 0);
         check_easyMock();
     }
+    SECTION("Copy from user retried after fault in")
+    {
+        CHECK(test_simple_fifo_write_fault_in_retry() == 0);
+        check_easyMock();
+    }
     SECTION("Fifo full")
     {
         CHECK(test_simple_fifo_write_fifo_full() == 0);
         check_easyMock();
     }
+    SECTION("Space left cached for the next writes")
+    {
+        CHECK(test_simple_fifo_write_cached_writable() == 0);
+        check_easyMock();
+    }
+    SECTION("Cached space dropped when the readers change")
+    {
+        CHECK(test_simple_fifo_write_readers_changed() == 0);
+        check_easyMock();
+    }
+    SECTION("Zero size write")
+    {
+        CHECK(test_simple_fifo_write_zero_size() == 0);
+        check_easyMock();
+    }
     SECTION("Partial write")
     {
         CHECK(test_simple_fifo_write_fifo_partial_write() == 0);
         check_easyMock();
     }
+    SECTION("Atomic write without room")
+    {
+        CHECK(test_simple_fifo_write_atomic_no_room() == 0);
+        check_easyMock();
+    }
+    SECTION("Full length write")
+    {
+        CHECK(test_simple_fifo_write_full_length() == 0);
+        check_easyMock();
+    }
     SECTION("Write first file but second is full")
     {
         CHECK(test_simple_fifo_write_fifo_write_first_file_second_is_full() == 0);
@@ -131,6 +221,101 @@ TEST_CASE("Write file", "[write]")
         CHECK(test_simple_fifo_write_fifo_write_two_file_one_is_write_only() == 0);
         check_easyMock();
     }
+    SECTION("Broadcast write two files")
+    {
+        CHECK(test_simple_fifo_write_broadcast_two_files() == 0);
+        check_easyMock();
+    }
+    SECTION("Broadcast write limited by slowest reader")
+    {
+        CHECK(test_simple_fifo_write_broadcast_slowest_reader_limits_write() == 0);
+        check_easyMock();
+    }
+    SECTION("Write to a broadcast fifo whose readers are all detached")
+    {
+        CHECK(test_simple_fifo_write_broadcast_all_detached() == 0);
+        check_easyMock();
+    }
+    SECTION("Write bigger than the shared ring without reader")
+    {
+        CHECK(test_simple_fifo_write_broadcast_no_reader() == 0);
+        check_easyMock();
+    }
+    SECTION("Write a record bigger than the shared ring without reader")
+    {
+        CHECK(test_simple_fifo_write_broadcast_no_reader_record_too_big() == 0);
+        check_easyMock();
+    }
+    SECTION("Full reader drops its oldest data")
+    {
+        CHECK(test_simple_fifo_write_drop_oldest() == 0);
+        check_easyMock();
+    }
+    SECTION("Full reader drops the new data")
+    {
+        CHECK(test_simple_fifo_write_drop_newest() == 0);
+        check_easyMock();
+    }
+    SECTION("Full reader is detached")
+    {
+        CHECK(test_simple_fifo_write_detach() == 0);
+        check_easyMock();
+    }
+    SECTION("Broadcast full reader drops its oldest data")
+    {
+        CHECK(test_simple_fifo_write_broadcast_drop_oldest() == 0);
+        check_easyMock();
+    }
+    SECTION("Write to a channel")
+    {
+        CHECK(test_simple_fifo_write_channel() == 0);
+        check_easyMock();
+    }
+    SECTION("Write to a channel in broadcast mode")
+    {
+        CHECK(test_simple_fifo_write_broadcast_channel() == 0);
+        check_easyMock();
+    }
+    SECTION("Write a record")
+    {
+        CHECK(test_simple_fifo_write_record() == 0);
+        check_easyMock();
+    }
+    SECTION("Write a record without room")
+    {
+        CHECK(test_simple_fifo_write_record_no_room() == 0);
+        check_easyMock();
+    }
+    SECTION("Write a record too big")
+    {
+        CHECK(test_simple_fifo_write_record_too_big() == 0);
+        check_easyMock();
+    }
+    SECTION("Write a record dropping the oldest records")
+    {
+        CHECK(test_simple_fifo_write_record_drop_oldest() == 0);
+        check_easyMock();
+    }
+    SECTION("Write part of an element")
+    {
+        CHECK(test_simple_fifo_write_partial_slot() == 0);
+        check_easyMock();
+    }
+    SECTION("Write iter")
+    {
+        CHECK(test_simple_fifo_write_iter() == 0);
+        check_easyMock();
+    }
+    SECTION("Write iter fault")
+    {
+        CHECK(test_simple_fifo_write_iter_fault() == 0);
+        check_easyMock();
+    }
+    SECTION("Write iter nowait locked")
+    {
+        CHECK(test_simple_fifo_write_iter_nowait_locked() == 0);
+        check_easyMock();
+    }
 }
 
 TEST_CASE("Release file", "[release_file]")
@@ -141,6 +326,36 @@ TEST_CASE("Release file", "[release_file]")
         CHECK(test_simple_fifo_release() == 0);
         check_easyMock();
     }
+    SECTION("Free write only file")
+    {
+        CHECK(test_simple_fifo_release_write_only() == 0);
+        check_easyMock();
+    }
+    SECTION("Release with a staging area")
+    {
+        CHECK(test_simple_fifo_release_staging() == 0);
+        check_easyMock();
+    }
+    SECTION("Release last file of a channel")
+    {
+        CHECK(test_simple_fifo_release_last_of_channel() == 0);
+        check_easyMock();
+    }
+    SECTION("Release write only file of a channel")
+    {
+        CHECK(test_simple_fifo_release_write_only_channel() == 0);
+        check_easyMock();
+    }
+    SECTION("Free after grace period")
+    {
+        CHECK(test_simple_fifo_free_rcu() == 0);
+        check_easyMock();
+    }
+    SECTION("Free after grace period in broadcast mode")
+    {
+        CHECK(test_simple_fifo_free_rcu_broadcast() == 0);
+        check_easyMock();
+    }
 }
 
 TEST_CASE("Read file", "[read_file]")
@@ -151,6 +366,46 @@ TEST_CASE("Read file", "[read_file]")
         CHECK(test_simple_fifo_read_simple_read() == 0);
         check_easyMock();
     }
+    SECTION("Read a record")
+    {
+        CHECK(test_simple_fifo_read_record() == 0);
+        check_easyMock();
+    }
+    SECTION("Read a record buffer too small")
+    {
+        CHECK(test_simple_fifo_read_record_buffer_too_small() == 0);
+        check_easyMock();
+    }
+    SECTION("Record longer than the pending data")
+    {
+        CHECK(test_simple_fifo_read_record_beyond_pending() == 0);
+        check_easyMock();
+    }
+    SECTION("Read broadcast overtaken by the writers")
+    {
+        CHECK(test_simple_fifo_read_broadcast_overtaken() == 0);
+        check_easyMock();
+    }
+    SECTION("Read whole elements")
+    {
+        CHECK(test_simple_fifo_read_whole_slots() == 0);
+        check_easyMock();
+    }
+    SECTION("Read buffer smaller than an element")
+    {
+        CHECK(test_simple_fifo_read_buffer_smaller_than_slot() == 0);
+        check_easyMock();
+    }
+    SECTION("Read iter")
+    {
+        CHECK(test_simple_fifo_read_iter() == 0);
+        check_easyMock();
+    }
+    SECTION("Read iter nowait empty")
+    {
+        CHECK(test_simple_fifo_read_iter_nowait_empty() == 0);
+        check_easyMock();
+    }
     SECTION("Double read")
     {
         CHECK(test_simple_fifo_read_double_read() == 0);
@@ -176,6 +431,301 @@ TEST_CASE("Read file", "[read_file]")
         CHECK(test_simple_fifo_read_copy_to_user_fails() == 0);
         check_easyMock();
     }
+    SECTION("Read retried after faulting in the user pages")
+    {
+        CHECK(test_simple_fifo_read_fault_in_retry() == 0);
+        check_easyMock();
+    }
+    SECTION("Detached file")
+    {
+        CHECK(test_simple_fifo_read_detached() == 0);
+        check_easyMock();
+    }
+}
+
+TEST_CASE("Ioctl file", "[ioctl_file]")
+{
+    initialise_easyMock();
+    SECTION("Get size")
+    {
+        CHECK(test_simple_fifo_ioctl_get_size() == 0);
+        check_easyMock();
+    }
+    SECTION("Set size")
+    {
+        CHECK(test_simple_fifo_ioctl_set_size() == 0);
+        check_easyMock();
+    }
+    SECTION("Set invalid size")
+    {
+        CHECK(test_simple_fifo_ioctl_set_size_invalid() == 0);
+        check_easyMock();
+    }
+    SECTION("Set size smaller than pending data")
+    {
+        CHECK(test_simple_fifo_ioctl_set_size_busy() == 0);
+        check_easyMock();
+    }
+    SECTION("Set size in broadcast mode")
+    {
+        CHECK(test_simple_fifo_ioctl_set_size_broadcast() == 0);
+        check_easyMock();
+    }
+    SECTION("Get policy")
+    {
+        CHECK(test_simple_fifo_ioctl_get_policy() == 0);
+        check_easyMock();
+    }
+    SECTION("Set policy")
+    {
+        CHECK(test_simple_fifo_ioctl_set_policy() == 0);
+        check_easyMock();
+    }
+    SECTION("Set drop newest policy in broadcast mode")
+    {
+        CHECK(test_simple_fifo_ioctl_set_policy_broadcast_drop_newest() == 0);
+        check_easyMock();
+    }
+    SECTION("Set size while mapped")
+    {
+        CHECK(test_simple_fifo_ioctl_set_size_mapped() == 0);
+        check_easyMock();
+    }
+    SECTION("Set policy drop oldest while mapped")
+    {
+        CHECK(test_simple_fifo_ioctl_set_policy_mapped() == 0);
+        check_easyMock();
+    }
+    SECTION("Consume")
+    {
+        CHECK(test_simple_fifo_ioctl_consume() == 0);
+        check_easyMock();
+    }
+    SECTION("Consume more than pending")
+    {
+        CHECK(test_simple_fifo_ioctl_consume_too_much() == 0);
+        check_easyMock();
+    }
+    SECTION("Consume up to the middle of a record")
+    {
+        CHECK(test_simple_fifo_ioctl_consume_inside_record() == 0);
+        check_easyMock();
+    }
+    SECTION("Commit")
+    {
+        CHECK(test_simple_fifo_ioctl_commit() == 0);
+        check_easyMock();
+    }
+    SECTION("Commit out of the staging area")
+    {
+        CHECK(test_simple_fifo_ioctl_commit_out_of_range() == 0);
+        check_easyMock();
+    }
+    SECTION("Bind channel")
+    {
+        CHECK(test_simple_fifo_ioctl_bind_channel() == 0);
+        check_easyMock();
+    }
+    SECTION("Bind existing channel")
+    {
+        CHECK(test_simple_fifo_ioctl_bind_existing_channel() == 0);
+        check_easyMock();
+    }
+    SECTION("Bind channel twice")
+    {
+        CHECK(test_simple_fifo_ioctl_bind_channel_twice() == 0);
+        check_easyMock();
+    }
+    SECTION("Bind channel invalid name")
+    {
+        CHECK(test_simple_fifo_ioctl_bind_channel_invalid_name() == 0);
+        check_easyMock();
+    }
+    SECTION("Bind channel broadcast")
+    {
+        CHECK(test_simple_fifo_ioctl_bind_channel_broadcast() == 0);
+        check_easyMock();
+    }
+    SECTION("Bind channel broadcast with a write of the device")
+    {
+        CHECK(test_simple_fifo_ioctl_bind_channel_broadcast_write() == 0);
+        check_easyMock();
+    }
+}
+
+TEST_CASE("Poll file", "[poll_file]")
+{
+    initialise_easyMock();
+    SECTION("Empty fifo")
+    {
+        CHECK(test_simple_fifo_poll_empty() == 0);
+        check_easyMock();
+    }
+    SECTION("Data pending")
+    {
+        CHECK(test_simple_fifo_poll_data_pending() == 0);
+        check_easyMock();
+    }
+    SECTION("Other reader full")
+    {
+        CHECK(test_simple_fifo_poll_other_reader_full() == 0);
+        check_easyMock();
+    }
+    SECTION("Detached file")
+    {
+        CHECK(test_simple_fifo_poll_detached() == 0);
+        check_easyMock();
+    }
+    SECTION("Write only file")
+    {
+        CHECK(test_simple_fifo_poll_write_only() == 0);
+        check_easyMock();
+    }
+}
+
+TEST_CASE("Mmap file", "[mmap_file]")
+{
+    initialise_easyMock();
+    SECTION("Mmap OK")
+    {
+        CHECK(test_simple_fifo_mmap() == 0);
+        check_easyMock();
+    }
+    SECTION("Mmap writable")
+    {
+        CHECK(test_simple_fifo_mmap_writable() == 0);
+        check_easyMock();
+    }
+    SECTION("Mmap with drop oldest policy")
+    {
+        CHECK(test_simple_fifo_mmap_drop_oldest() == 0);
+        check_easyMock();
+    }
+    SECTION("Mmap staging area")
+    {
+        CHECK(test_simple_fifo_mmap_staging() == 0);
+        check_easyMock();
+    }
+    SECTION("Mmap staging area twice")
+    {
+        CHECK(test_simple_fifo_mmap_staging_twice() == 0);
+        check_easyMock();
+    }
+}
+
+TEST_CASE("Uring cmd", "[uring_cmd]")
+{
+    initialise_easyMock();
+    SECTION("Publish")
+    {
+        CHECK(test_simple_fifo_uring_cmd_publish() == 0);
+        check_easyMock();
+    }
+    SECTION("Publish a message too big")
+    {
+        CHECK(test_simple_fifo_uring_cmd_publish_too_big() == 0);
+        check_easyMock();
+    }
+    SECTION("Uring cmd publish read only")
+    {
+        CHECK(test_simple_fifo_uring_cmd_publish_read_only() == 0);
+        check_easyMock();
+    }
+    SECTION("Consume")
+    {
+        CHECK(test_simple_fifo_uring_cmd_consume() == 0);
+        check_easyMock();
+    }
+    SECTION("Occupancy")
+    {
+        CHECK(test_simple_fifo_uring_cmd_occupancy() == 0);
+        check_easyMock();
+    }
+    SECTION("Uring cmd occupancy overtaken")
+    {
+        CHECK(test_simple_fifo_uring_cmd_occupancy_overtaken() == 0);
+        check_easyMock();
+    }
+    SECTION("Invalid flags")
+    {
+        CHECK(test_simple_fifo_uring_cmd_invalid_flags() == 0);
+        check_easyMock();
+    }
+}
+
+TEST_CASE("Configfs", "[configfs]")
+{
+    initialise_easyMock();
+    SECTION("Make item")
+    {
+        CHECK(test_configfs_make_item() == 0);
+        check_easyMock();
+    }
+    SECTION("No minor left")
+    {
+        CHECK(test_configfs_make_item_no_minor() == 0);
+        check_easyMock();
+    }
+    SECTION("Make item cdev_add fails")
+    {
+        CHECK(test_configfs_make_item_cdev_add_fail() == 0);
+        check_easyMock();
+    }
+    SECTION("Drop item")
+    {
+        CHECK(test_configfs_drop_item() == 0);
+        check_easyMock();
+    }
+    SECTION("Instance release")
+    {
+        CHECK(test_configfs_instance_release() == 0);
+        check_easyMock();
+    }
+    SECTION("Instance release broadcast")
+    {
+        CHECK(test_configfs_instance_release_broadcast() == 0);
+        check_easyMock();
+    }
+    SECTION("Store fifo_size")
+    {
+        CHECK(test_configfs_fifo_size_store() == 0);
+        check_easyMock();
+    }
+    SECTION("Store fifo_size broadcast")
+    {
+        CHECK(test_configfs_fifo_size_store_broadcast() == 0);
+        check_easyMock();
+    }
+    SECTION("Store slow_reader_policy")
+    {
+        CHECK(test_configfs_slow_reader_policy_store() == 0);
+        check_easyMock();
+    }
+    SECTION("Store invalid slow_reader_policy")
+    {
+        CHECK(test_configfs_slow_reader_policy_store_invalid() == 0);
+        check_easyMock();
+    }
+    SECTION("Store record_mode")
+    {
+        CHECK(test_configfs_record_mode_store() == 0);
+        check_easyMock();
+    }
+    SECTION("Store record_mode while opened")
+    {
+        CHECK(test_configfs_record_mode_store_busy() == 0);
+        check_easyMock();
+    }
+    SECTION("Store slot_size")
+    {
+        CHECK(test_configfs_slot_size_store() == 0);
+        check_easyMock();
+    }
+    SECTION("Store slot_size in record mode")
+    {
+        CHECK(test_configfs_slot_size_store_record_mode() == 0);
+        check_easyMock();
+    }
 }
 
 TEST_CASE("Exit module", "[exit_module]")
@@ -2,6 +2,8 @@
 #define module_exit(initfn)
 #define __init
 #define __exit
+#define module_param(name, type, perm)
+#define MODULE_PARM_DESC(_parm, desc)
 static struct module __this_module;
 #define THIS_MODULE (&__this_module)
 /*
@@ -21,8 +23,18 @@ static struct module __this_module;
 #include <string.h>
 
 static dev_t major_minor_to_test = MKDEV(42, 0);
-#define DO_NOT_FAIL (0)
-#define DO_FAIL (1)
+/*
+ * The tests use a small ring so that the expected content of the ring can be written by hand.
+ */
+#define TEST_FIFO_SIZE ((size_t)64)
+static uint8_t test_rings[2][TEST_FIFO_SIZE];
+/*
+ * The private rings allocated by the module follow their control page.
+ */
+static uint8_t test_mappable_ring[PAGE_SIZE + TEST_FIFO_SIZE];
+static uint8_t test_resized_ring[PAGE_SIZE + SIMPLE_FIFO_MIN_SIZE];
+static struct kmem_cache* test_fpd_cache = (struct kmem_cache*)0xcac4e;
+static struct simpleFifo_device_data test_devices[2];
 
 static int cmp_not_null_pointer(const void *currentCall_ptr, const void *not_used, const char *paramName,
                        char *errorMessage) {
@@ -36,19 +48,48 @@ static int cmp_not_null_pointer(const void *currentCall_ptr, const void *not_use
 /*
  * Some static helper functions to avoid retyping all the time the same in the actual tests.
  */
+static void expect_check_size_ok()
+{
+    __roundup_pow_of_two_ExpectAndReturn(SIMPLE_FIFO_DEFAULT_SIZE, SIMPLE_FIFO_DEFAULT_SIZE, cmp_u_long);
+}
+
+static void expect_fpd_cache_create(struct kmem_cache* cacheToReturn)
+{
+    kmem_cache_create_ExpectAndReturn("simple_fifo_file", sizeof(struct file_private_data), 0, SLAB_HWCACHE_ALIGN | SLAB_ACCOUNT, NULL, cacheToReturn, cmp_str, cmp_u_int, cmp_u_int, cmp_u_int, NULL);
+}
+
+static void expect_fpd_cache_destroy(struct kmem_cache* cacheToDestroy)
+{
+    kmem_cache_destroy_ExpectAndReturn(cacheToDestroy, cmp_pointer);
+}
+
+static void expect_kcalloc_devices(struct simpleFifo_device_data* devicesToReturn)
+{
+    if(devicesToReturn != NULL)
+    {
+        memset(devicesToReturn, 0, nb_fifos * sizeof(struct simpleFifo_device_data));
+    }
+    kcalloc_ExpectAndReturn(nb_fifos, sizeof(struct simpleFifo_device_data), GFP_KERNEL, devicesToReturn, cmp_u_long, cmp_u_long, cmp_int);
+}
+
 static void expect_alloc_chrdev_region_ok()
 {
-    alloc_chrdev_region_ExpectReturnAndOutput(NULL, 0, 1, "simpleFifo", 0, NULL, cmp_int, cmp_int, cmp_str, &major_minor_to_test);
+    alloc_chrdev_region_ExpectReturnAndOutput(NULL, 0, SIMPLE_FIFO_MAX_FIFOS, "simpleFifo", 0, NULL, cmp_int, cmp_u_int, cmp_str, &major_minor_to_test);
+}
+
+static dev_t test_devt(unsigned int minor)
+{
+    return MKDEV(MAJOR(major_minor_to_test), minor);
 }
 
-static void expect_device_destroy(struct class* ptr_to_check)
+static void expect_device_destroy(struct class* ptr_to_check, unsigned int minor)
 {
-    device_destroy_ExpectAndReturn(ptr_to_check, major_minor_to_test, cmp_pointer, cmp_int);
+    device_destroy_ExpectAndReturn(ptr_to_check, test_devt(minor), cmp_pointer, cmp_int);
 }
 
 static void expect_unregister_chrdev_region()
 {
-    unregister_chrdev_region_ExpectAndReturn(major_minor_to_test, MINORMASK, cmp_int, cmp_int);
+    unregister_chrdev_region_ExpectAndReturn(major_minor_to_test, SIMPLE_FIFO_MAX_FIFOS, cmp_int, cmp_u_int);
 }
 
 static void expect_class_create_ok(struct class* classToReturn)
@@ -56,9 +97,20 @@ static void expect_class_create_ok(struct class* classToReturn)
     __class_create_ExpectAndReturn(THIS_MODULE, "simpleFifo", NULL, classToReturn, cmp_pointer, cmp_str, NULL);
 }
 
-static void expect_cdev_init_ok()
+/*
+ * Expects the state of a fifo to be initialised before its cdev is added.
+ */
+static void expect_device_setup(struct simpleFifo_device_data* data)
+{
+    __mutex_init_ExpectAndReturn(&data->open_file_list_mutex, "&data->open_file_list_mutex", NULL, cmp_pointer, cmp_str, NULL);
+    INIT_LIST_HEAD_ExpectAndReturn(&data->opened_file_list, cmp_pointer);
+    __mutex_init_ExpectAndReturn(&data->write_mutex, "&data->write_mutex", NULL, cmp_pointer, cmp_str, NULL);
+    __init_waitqueue_head_ExpectAndReturn(&data->writeWait, "&data->writeWait", NULL, cmp_pointer, cmp_str, NULL);
+}
+
+static void expect_cdev_init_ok(struct simpleFifo_device_data* data)
 {
-    cdev_init_ExpectAndReturn(&simpleFifo_data.cdev, &simpleFifo_fops, cmp_pointer, cmp_pointer);
+    cdev_init_ExpectAndReturn(&data->cdev, &simpleFifo_fops, cmp_pointer, cmp_pointer);
 }
 
 static void expect_cdev_del(struct cdev* cdev_to_expect)
@@ -66,16 +118,42 @@ static void expect_cdev_del(struct cdev* cdev_to_expect)
     cdev_del_ExpectAndReturn(cdev_to_expect, cmp_deref_ptr_struct_cdev);
 }
 
-static void expect_cdev_add_ok(struct cdev* expectedCdev)
+static void expect_cdev_add(struct simpleFifo_device_data* data, struct cdev* expectedCdev, unsigned int minor, int rv)
 {
-    memcpy(expectedCdev, &simpleFifo_data.cdev, sizeof(struct cdev));
+    memcpy(expectedCdev, &data->cdev, sizeof(struct cdev));
     expectedCdev->owner = THIS_MODULE;
-    cdev_add_ExpectAndReturn(expectedCdev, major_minor_to_test, 1, 0, cmp_deref_ptr_struct_cdev, cmp_int, cmp_u_int);
+    cdev_add_ExpectAndReturn(expectedCdev, test_devt(minor), 1, rv, cmp_deref_ptr_struct_cdev, cmp_int, cmp_u_int);
+}
+
+static void expect_device_create(struct class* classArg, unsigned int minor, struct device* devToReturn)
+{
+    device_create_ExpectAndReturn(classArg, NULL, test_devt(minor), NULL, "simplefifo-%u", devToReturn, cmp_pointer, cmp_pointer, cmp_int, cmp_pointer, cmp_str);
+}
+
+static void expect_configfs_register(int rv)
+{
+    config_group_init_ExpectAndReturn(&simple_fifo_subsys.su_group, cmp_pointer);
+    __mutex_init_ExpectAndReturn(&simple_fifo_subsys.su_mutex, "&simple_fifo_subsys.su_mutex", NULL, cmp_pointer, cmp_str, NULL);
+    configfs_register_subsystem_ExpectAndReturn(&simple_fifo_subsys, rv, cmp_pointer);
 }
 
-static void expect_device_create_ok(struct class* classArg, struct device* devToReturn)
+static void expect_device_init_ok(struct simpleFifo_device_data* data, unsigned int minor, struct class* classArg, struct cdev* expectedCdev, struct device* devToReturn)
 {
-    device_create_ExpectAndReturn(classArg, NULL, major_minor_to_test, NULL, "simplefifo-%d", devToReturn, cmp_deref_ptr_struct_class, cmp_pointer, cmp_int, cmp_pointer, cmp_str);
+    expect_device_setup(data);
+    expect_cdev_init_ok(data);
+    expect_cdev_add(data, expectedCdev, minor, 0);
+    expect_device_create(classArg, minor, devToReturn);
+}
+
+/*
+ * Expects the module wide resources to be released when the init fails after the class has been created.
+ */
+static void expect_init_cleanup(struct class* createdClass)
+{
+    class_destroy_ExpectAndReturn(createdClass, cmp_pointer);
+    expect_unregister_chrdev_region();
+    kfree_ExpectAndReturn(test_devices, cmp_pointer);
+    expect_fpd_cache_destroy(test_fpd_cache);
 }
 
 /*
@@ -87,24 +165,18 @@ int test_init_module_no_errors()
 {
     // Test setup
     struct device dev;
+    struct class classToReturn;
+    struct cdev expectedCdev;
     {
+        expect_check_size_ok();
+        expect_fpd_cache_create(test_fpd_cache);
+        expect_kcalloc_devices(test_devices);
         expect_alloc_chrdev_region_ok();
-
-        struct class classToReturn;
         expect_class_create_ok(&classToReturn);
-
-        expect_cdev_init_ok();
-
-        struct cdev expectedCdev;
-        expect_cdev_add_ok(&expectedCdev);
-
-        expect_device_create_ok(&classToReturn, &dev);
-
-        __mutex_init_ExpectAndReturn(&simpleFifo_data.open_file_list_mutex, "&simpleFifo_data.open_file_list_mutex", NULL, cmp_pointer, cmp_str, NULL);
-        INIT_LIST_HEAD_ExpectAndReturn(&simpleFifo_data.opened_file_list, cmp_pointer);
+        expect_device_init_ok(&test_devices[0], 0, &classToReturn, &expectedCdev, &dev);
+        expect_configfs_register(0);
 
         _printk_ExpectAndReturn(NULL, 0, NULL);
-
     }
 
     // Run function to test and check result
@@ -114,11 +186,151 @@ int test_init_module_no_errors()
         if (rv != 0) {
             easyMock_addError(easyMock_true, "simple_fifo_init didn't return 0");
         }
-        if(simpleFifo_data.dev != &dev)
+        if(simpleFifo_devices != test_devices)
+        {
+            easyMock_addError(easyMock_true, "simple_fifo_init didn't set the devices correctly (%p != %p)", simpleFifo_devices, test_devices);
+        }
+        if(test_devices[0].dev != &dev)
+        {
+            easyMock_addError(easyMock_true, "simple_fifo_init didn't set dev correctly (%p != %p)", test_devices[0].dev, &dev);
+        }
+        if(fifo_capacity != SIMPLE_FIFO_DEFAULT_SIZE || test_devices[0].capacity != SIMPLE_FIFO_DEFAULT_SIZE)
         {
-            easyMock_addError(easyMock_true, "simple_fifo_init didn't set dev correctly (%p != %p)", simpleFifo_data.dev, &dev);
+            easyMock_addError(easyMock_true, "simple_fifo_init didn't set capacity correctly (%zu != %zu)", test_devices[0].capacity, SIMPLE_FIFO_DEFAULT_SIZE);
+        }
+    }
+    return 0;
+}
+
+int test_init_module_two_fifos()
+{
+    unsigned int savedNbFifos = nb_fifos;
+    nb_fifos = 2;
+    struct device dev[2];
+    struct class classToReturn;
+    struct cdev expectedCdev[2];
+
+    expect_check_size_ok();
+    expect_fpd_cache_create(test_fpd_cache);
+    expect_kcalloc_devices(test_devices);
+    expect_alloc_chrdev_region_ok();
+    expect_class_create_ok(&classToReturn);
+    for(unsigned int minor = 0; minor < 2; ++minor)
+    {
+        expect_device_init_ok(&test_devices[minor], minor, &classToReturn, &expectedCdev[minor], &dev[minor]);
+    }
+    expect_configfs_register(0);
+    _printk_ExpectAndReturn(NULL, 0, NULL);
+
+    int rv = simple_fifo_init();
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return 0 (%d)", rv);
+    }
+    for(unsigned int minor = 0; minor < 2; ++minor)
+    {
+        if(test_devices[minor].dev != &dev[minor])
+        {
+            easyMock_addError(easyMock_true, "simple_fifo_init didn't set dev of minor %u correctly", minor);
+        }
+    }
+    nb_fifos = savedNbFifos;
+    return 0;
+}
+
+int test_init_module_invalid_fifo_size()
+{
+    // Test setup
+    unsigned long savedFifoSize = fifo_size;
+    fifo_size = SIMPLE_FIFO_MIN_SIZE - 1;
+    {
+        _printk_ExpectAndReturn(NULL, 0, NULL);
+    }
+
+    // Run function to test and check result
+    {
+        int rv = simple_fifo_init();
+        if (rv != -EINVAL) {
+            easyMock_addError(easyMock_true, "simple_fifo_init didn't return -EINVAL (%d)", rv);
         }
     }
+    fifo_size = savedFifoSize;
+    return 0;
+}
+
+int test_init_module_invalid_slow_reader_policy()
+{
+    unsigned int savedPolicy = slow_reader_policy;
+    slow_reader_policy = SIMPLE_FIFO_POLICY_DETACH + 1;
+    expect_check_size_ok();
+    _printk_ExpectAndReturn(NULL, 0, NULL);
+
+    int rv = simple_fifo_init();
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return -EINVAL (%d)", rv);
+    }
+    slow_reader_policy = savedPolicy;
+    return 0;
+}
+
+int test_init_module_invalid_slot_size()
+{
+    unsigned int savedSlotSize = slot_size;
+    slot_size = 12;
+    expect_check_size_ok();
+    _printk_ExpectAndReturn(NULL, 0, NULL);
+
+    int rv = simple_fifo_init();
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return -EINVAL (%d)", rv);
+    }
+    slot_size = savedSlotSize;
+    return 0;
+}
+
+int test_init_module_invalid_nb_fifos()
+{
+    unsigned int savedNbFifos = nb_fifos;
+    nb_fifos = 0;
+    expect_check_size_ok();
+    _printk_ExpectAndReturn(NULL, 0, NULL);
+
+    int rv = simple_fifo_init();
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return -EINVAL (%d)", rv);
+    }
+    nb_fifos = savedNbFifos;
+    return 0;
+}
+
+int test_init_module_fpd_cache_create_fail()
+{
+    expect_check_size_ok();
+    expect_fpd_cache_create(NULL);
+
+    int rv = simple_fifo_init();
+    if(rv != -ENOMEM)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return -ENOMEM (%d)", rv);
+    }
+    return 0;
+}
+
+int test_init_module_kcalloc_fail()
+{
+    expect_check_size_ok();
+    expect_fpd_cache_create(test_fpd_cache);
+    expect_kcalloc_devices(NULL);
+    expect_fpd_cache_destroy(test_fpd_cache);
+
+    int rv = simple_fifo_init();
+    if(rv != -ENOMEM)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return -ENOMEM (%d)", rv);
+    }
     return 0;
 }
 
@@ -126,9 +338,16 @@ int test_init_module_alloc_chrdev_region_fail()
 {
     // Test setup
     {
+        expect_check_size_ok();
+        expect_fpd_cache_create(test_fpd_cache);
+        expect_kcalloc_devices(test_devices);
         //Configure alloc_chrdev_region to return -1
-        alloc_chrdev_region_ExpectReturnAndOutput(NULL, 0, 1, "simpleFifo", -1, NULL, cmp_int, cmp_int, cmp_str,
+        alloc_chrdev_region_ExpectReturnAndOutput(NULL, 0, SIMPLE_FIFO_MAX_FIFOS, "simpleFifo", -1, NULL, cmp_int, cmp_u_int, cmp_str,
                                                   &major_minor_to_test);
+
+        //Checks simple_fifo_init frees the devices and destroys the previously created cache
+        kfree_ExpectAndReturn(test_devices, cmp_pointer);
+        expect_fpd_cache_destroy(test_fpd_cache);
     }
 
     // Run function to test and check result
@@ -147,6 +366,9 @@ int test_init_module_class_create_fail()
 {
     // Test setup
     {
+        expect_check_size_ok();
+        expect_fpd_cache_create(test_fpd_cache);
+        expect_kcalloc_devices(test_devices);
         expect_alloc_chrdev_region_ok();
 
         //Configure class_create to return NULL ptr
@@ -154,6 +376,8 @@ int test_init_module_class_create_fail()
 
         //Checks simple_fifo_init cleans up the previously created chrdev_region
         expect_unregister_chrdev_region();
+        kfree_ExpectAndReturn(test_devices, cmp_pointer);
+        expect_fpd_cache_destroy(test_fpd_cache);
     }
 
     // Run function to test and check result
@@ -170,23 +394,22 @@ int test_init_module_class_create_fail()
 int test_init_module_cdev_add_fail()
 {
     // Test setup
+    struct class classToReturn;
+    struct cdev expectedCdev;
     {
+        expect_check_size_ok();
+        expect_fpd_cache_create(test_fpd_cache);
+        expect_kcalloc_devices(test_devices);
         expect_alloc_chrdev_region_ok();
-
-        struct class classToReturn;
         expect_class_create_ok(&classToReturn);
-
-        expect_cdev_init_ok();
+        expect_device_setup(&test_devices[0]);
+        expect_cdev_init_ok(&test_devices[0]);
 
         //Configure cdev_add to return -1
-        struct cdev expectedCdev;
-        memcpy(&expectedCdev, &simpleFifo_data.cdev, sizeof(expectedCdev));
-        expectedCdev.owner = THIS_MODULE;
-        cdev_add_ExpectAndReturn(&expectedCdev, major_minor_to_test, 1, -1, cmp_deref_ptr_struct_cdev, cmp_int,
-                                 cmp_u_int);
+        expect_cdev_add(&test_devices[0], &expectedCdev, 0, -1);
 
-        //Checks simple_fifo_init cleans up the previously created chrdev_region
-        expect_unregister_chrdev_region();
+        //Checks simple_fifo_init cleans up the previously created class and chrdev_region
+        expect_init_cleanup(&classToReturn);
     }
 
     // Run function to test and check result
@@ -203,25 +426,24 @@ int test_init_module_cdev_add_fail()
 int test_init_module_device_create_fail()
 {
     // Test setup
+    struct class classToReturn;
+    struct cdev expectedCdev;
     {
+        expect_check_size_ok();
+        expect_fpd_cache_create(test_fpd_cache);
+        expect_kcalloc_devices(test_devices);
         expect_alloc_chrdev_region_ok();
-
-        struct class classToReturn;
         expect_class_create_ok(&classToReturn);
-
-        expect_cdev_init_ok();
-
-        struct cdev expectedCdev;
-        expect_cdev_add_ok(&expectedCdev);
+        expect_device_setup(&test_devices[0]);
+        expect_cdev_init_ok(&test_devices[0]);
+        expect_cdev_add(&test_devices[0], &expectedCdev, 0, 0);
 
         //Configure device_create to return NULL
-        device_create_ExpectAndReturn(&classToReturn, NULL, major_minor_to_test, NULL, "simplefifo-%d", NULL,
-                                      cmp_pointer, cmp_pointer, cmp_int, cmp_pointer, cmp_str);
+        expect_device_create(&classToReturn, 0, NULL);
 
         //Checks simple_fifo_init cleans up the previously created cdev
         expect_cdev_del(&expectedCdev);
-        //Checks simple_fifo_init cleans up the previously created chrdev_region
-        expect_unregister_chrdev_region();
+        expect_init_cleanup(&classToReturn);
     }
 
     // Run function to test and check result
@@ -235,6 +457,64 @@ int test_init_module_device_create_fail()
     return 0;
 }
 
+int test_init_module_second_fifo_fails()
+{
+    unsigned int savedNbFifos = nb_fifos;
+    nb_fifos = 2;
+    struct device dev;
+    struct class classToReturn;
+    struct cdev expectedCdev[2];
+
+    expect_check_size_ok();
+    expect_fpd_cache_create(test_fpd_cache);
+    expect_kcalloc_devices(test_devices);
+    expect_alloc_chrdev_region_ok();
+    expect_class_create_ok(&classToReturn);
+    expect_device_init_ok(&test_devices[0], 0, &classToReturn, &expectedCdev[0], &dev);
+    expect_device_setup(&test_devices[1]);
+    expect_cdev_init_ok(&test_devices[1]);
+    expect_cdev_add(&test_devices[1], &expectedCdev[1], 1, -1);
+
+    // The first fifo is removed before the module wide resources
+    expect_device_destroy(&classToReturn, 0);
+    expect_cdev_del(&expectedCdev[0]);
+    expect_init_cleanup(&classToReturn);
+
+    int rv = simple_fifo_init();
+    if(rv != -1)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return the cdev_add error (%d)", rv);
+    }
+    nb_fifos = savedNbFifos;
+    return 0;
+}
+
+int test_init_module_configfs_register_fail()
+{
+    struct device dev;
+    struct class classToReturn;
+    struct cdev expectedCdev;
+
+    expect_check_size_ok();
+    expect_fpd_cache_create(test_fpd_cache);
+    expect_kcalloc_devices(test_devices);
+    expect_alloc_chrdev_region_ok();
+    expect_class_create_ok(&classToReturn);
+    expect_device_init_ok(&test_devices[0], 0, &classToReturn, &expectedCdev, &dev);
+    expect_configfs_register(-ENOMEM);
+
+    expect_device_destroy(&classToReturn, 0);
+    expect_cdev_del(&expectedCdev);
+    expect_init_cleanup(&classToReturn);
+
+    int rv = simple_fifo_init();
+    if(rv != -ENOMEM)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_init didn't return -ENOMEM (%d)", rv);
+    }
+    return 0;
+}
+
 int test_simple_fifo_open()
 {
     // Test setup
@@ -244,15 +524,18 @@ int test_simple_fifo_open()
 
     inode.i_cdev = &data.cdev;
 
+    data.capacity = TEST_FIFO_SIZE;
+
     struct file_private_data pd = {0};
-    pd.writeOffset = 0xca;
     pd.readOffset = 0xfe;
-    pd.size = 0xde;
 
-    devm_kzalloc_ExpectAndReturn(data.dev, sizeof(struct file_private_data), GFP_KERNEL, &pd, cmp_pointer, cmp_int, cmp_int);
+    kmem_cache_zalloc_ExpectAndReturn(fpd_cache, GFP_KERNEL, &pd, cmp_pointer, cmp_int);
+    vmalloc_user_ExpectAndReturn(PAGE_SIZE + TEST_FIFO_SIZE, test_mappable_ring, cmp_u_long);
+    __init_waitqueue_head_ExpectAndReturn(&pd.privateRing.readWait, "&ring->readWait", NULL, cmp_pointer, cmp_str, NULL);
+    __mutex_init_ExpectAndReturn(&pd.read_mutex, "&fpd->read_mutex", NULL, cmp_pointer, cmp_str, NULL);
+    __mutex_init_ExpectAndReturn(&pd.map_mutex, "&fpd->map_mutex", NULL, cmp_pointer, cmp_str, NULL);
     mutex_lock_ExpectAndReturn(&data.open_file_list_mutex, cmp_pointer);
-    INIT_LIST_HEAD_ExpectAndReturn(&pd.file_entry, cmp_pointer);
-    list_add_ExpectAndReturn(&pd.file_entry, &data.opened_file_list, cmp_pointer, cmp_pointer);
+    list_add_rcu_ExpectAndReturn(&pd.file_entry, &data.opened_file_list, cmp_pointer, cmp_pointer);
     mutex_unlock_ExpectAndReturn(&data.open_file_list_mutex, cmp_pointer);
 
     // Call function to test
@@ -271,37 +554,109 @@ int test_simple_fifo_open()
     struct file_private_data *filePrivateData = (struct file_private_data*)file.private_data;
 
     struct simpleFifo_device_data *parentToExpect = &data;
-    uint8_t sizeToExpect = 0;
-    uint8_t readOffsetToExpect = 0;
-    uint8_t writeOffsetToExpect = 0;
+    size_t readOffsetToExpect = 0;
+    size_t writeOffsetToExpect = 0;
     if(filePrivateData->parent != parentToExpect)
     {
         easyMock_addError(easyMock_true, "parent hasn't  been set correctly modified (%p != %p)", filePrivateData->parent, parentToExpect);
     }
+    if(filePrivateData->ring != &pd.privateRing)
+    {
+        easyMock_addError(easyMock_true, "ring hasn't been set to the private ring (%p != %p)", filePrivateData->ring, &pd.privateRing);
+    }
+    if(pd.privateRing.ctrl != (struct simple_fifo_mmap_ctrl*)test_mappable_ring || pd.privateRing.data != test_mappable_ring + PAGE_SIZE)
+    {
+        easyMock_addError(easyMock_true, "data hasn't been set after the allocated control page (%p != %p)", pd.privateRing.data, test_mappable_ring + PAGE_SIZE);
+    }
+    if(pd.privateRing.capacity != TEST_FIFO_SIZE)
+    {
+        easyMock_addError(easyMock_true, "capacity hasn't been set to the device capacity (%zu != %zu)", pd.privateRing.capacity, TEST_FIFO_SIZE);
+    }
+    if(pd.privateRing.writeOffset != writeOffsetToExpect)
+    {
+        easyMock_addError(easyMock_true, "writeOffset hasn't been zeroized (%zu != %zu)", pd.privateRing.writeOffset, writeOffsetToExpect);
+    }
     if(filePrivateData->readOffset != readOffsetToExpect)
     {
-        easyMock_addError(easyMock_true, "readOffset hasn't been zeroized (%d != %d)", filePrivateData->readOffset, readOffsetToExpect);
+        easyMock_addError(easyMock_true, "readOffset hasn't been zeroized (%zu != %zu)", filePrivateData->readOffset, readOffsetToExpect);
+    }
+    if(!(file.f_mode & FMODE_NOWAIT))
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_open didn't set FMODE_NOWAIT");
+    }
+    return 0;
+}
+
+int test_simple_fifo_open_broadcast()
+{
+    struct inode inode;
+    struct file file = {0};
+    struct simpleFifo_device_data data = {0};
+    struct file_private_data pd = {0};
+
+    inode.i_cdev = &data.cdev;
+    data.capacity = TEST_FIFO_SIZE;
+    data.broadcast = true;
+    data.sharedRing.data = test_rings[0];
+    data.sharedRing.capacity = TEST_FIFO_SIZE;
+    data.sharedRing.writeOffset = 42;
+
+    kmem_cache_zalloc_ExpectAndReturn(fpd_cache, GFP_KERNEL, &pd, cmp_pointer, cmp_int);
+    __mutex_init_ExpectAndReturn(&pd.read_mutex, "&fpd->read_mutex", NULL, cmp_pointer, cmp_str, NULL);
+    __mutex_init_ExpectAndReturn(&pd.map_mutex, "&fpd->map_mutex", NULL, cmp_pointer, cmp_str, NULL);
+    mutex_lock_ExpectAndReturn(&data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&data.open_file_list_mutex, cmp_pointer);
+    list_add_rcu_ExpectAndReturn(&pd.file_entry, &data.opened_file_list, cmp_pointer, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&data.open_file_list_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&data.write_mutex, cmp_pointer);
+
+    int rv = simple_fifo_open(&inode, &file);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_open didn't return 0");
+    }
+    if(pd.ring != &data.sharedRing)
+    {
+        easyMock_addError(easyMock_true, "ring hasn't been set to the shared ring (%p != %p)", pd.ring, &data.sharedRing);
     }
-    if(filePrivateData->writeOffset != writeOffsetToExpect)
+    if(pd.readOffset != 42)
     {
-        easyMock_addError(easyMock_true, "writeOffset hasn't been zeroized (%d != %d)", filePrivateData->writeOffset, writeOffsetToExpect);
+        easyMock_addError(easyMock_true, "readOffset hasn't been set to the write offset of the shared ring (%zu != 42)", pd.readOffset);
     }
-    if(filePrivateData->size != sizeToExpect)
+    return 0;
+}
+
+int test_simple_fifo_open_alloc_fail()
+{
+    struct inode inode;
+    struct file file = {0};
+    struct simpleFifo_device_data data = {0};
+
+    inode.i_cdev = &data.cdev;
+
+    kmem_cache_zalloc_ExpectAndReturn(fpd_cache, GFP_KERNEL, NULL, cmp_pointer, cmp_int);
+
+    int rv = simple_fifo_open(&inode, &file);
+    if(rv != -ENOMEM)
     {
-        easyMock_addError(easyMock_true, "size hasn't been zeroized (%d != %d)", filePrivateData->size, sizeToExpect);
+        easyMock_addError(easyMock_true, "simple_fifo_open didn't return -ENOMEM (%d)", rv);
     }
     return 0;
 }
 
-int test_simple_fifo_open_devm_kzalloc_fail()
+int test_simple_fifo_open_kvmalloc_fail()
 {
     struct inode inode;
     struct file file = {0};
     struct simpleFifo_device_data data = {0};
+    struct file_private_data pd = {0};
 
     inode.i_cdev = &data.cdev;
+    data.capacity = TEST_FIFO_SIZE;
 
-    devm_kzalloc_ExpectAndReturn(data.dev, sizeof(struct file_private_data), GFP_KERNEL, NULL, cmp_pointer, cmp_int, cmp_int);
+    kmem_cache_zalloc_ExpectAndReturn(fpd_cache, GFP_KERNEL, &pd, cmp_pointer, cmp_int);
+    vmalloc_user_ExpectAndReturn(PAGE_SIZE + TEST_FIFO_SIZE, NULL, cmp_u_long);
+    kmem_cache_free_ExpectAndReturn(fpd_cache, &pd, cmp_pointer, cmp_pointer);
 
     int rv = simple_fifo_open(&inode, &file);
     if(rv != -ENOMEM)
@@ -311,26 +666,95 @@ int test_simple_fifo_open_devm_kzalloc_fail()
     return 0;
 }
 
-static void check_result(struct file_private_data* data, uint8_t expectedSize, uint8_t expectedReadOffset, uint8_t expectedWriteOffset, void* bufToExpect)
+int test_simple_fifo_open_write_only()
+{
+    struct inode inode;
+    struct file file = {0};
+    struct simpleFifo_device_data data = {0};
+    struct file_private_data pd = {0};
+
+    inode.i_cdev = &data.cdev;
+    data.capacity = TEST_FIFO_SIZE;
+    file.f_flags = O_WRONLY;
+
+    kmem_cache_zalloc_ExpectAndReturn(fpd_cache, GFP_KERNEL, &pd, cmp_pointer, cmp_int);
+    __mutex_init_ExpectAndReturn(&pd.read_mutex, "&fpd->read_mutex", NULL, cmp_pointer, cmp_str, NULL);
+    __mutex_init_ExpectAndReturn(&pd.map_mutex, "&fpd->map_mutex", NULL, cmp_pointer, cmp_str, NULL);
+
+    int rv = simple_fifo_open(&inode, &file);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_open didn't return 0");
+    }
+    if(file.private_data != &pd || pd.parent != &data)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_open didn't set up the private data of the file");
+    }
+    if(pd.ring != NULL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_open gave a ring to a write only file (%p)", pd.ring);
+    }
+    return 0;
+}
+
+static void check_result(struct file_private_data* data, size_t expectedSize, size_t expectedReadOffset, size_t expectedWriteOffset, void* bufToExpect)
 {
-    if(data->size != expectedSize)
+    size_t size = data->ring->writeOffset - data->readOffset;
+    if(size != expectedSize)
     {
-        easyMock_addError(easyMock_true, "tested function didn't update size to expectedSize (%d != %d)", data->size, expectedSize);
+        easyMock_addError(easyMock_true, "tested function didn't update size to expectedSize (%zu != %zu)", size, expectedSize);
     }
     if(data->readOffset != expectedReadOffset)
     {
-        easyMock_addError(easyMock_true, "tested function didn't update readOffset to expectedReadOffset (%d != %d)", data->readOffset, expectedReadOffset);
+        easyMock_addError(easyMock_true, "tested function didn't update readOffset to expectedReadOffset (%zu != %zu)", data->readOffset, expectedReadOffset);
     }
-    if(data->writeOffset != expectedWriteOffset)
+    if(data->ring->writeOffset != expectedWriteOffset)
     {
-        easyMock_addError(easyMock_true, "tested function didn't update writeOffset to expectedWriteOffset (%d != %d)", data->writeOffset, expectedWriteOffset);
+        easyMock_addError(easyMock_true, "tested function didn't update writeOffset to expectedWriteOffset (%zu != %zu)", data->ring->writeOffset, expectedWriteOffset);
     }
-    if(memcmp(data->data, bufToExpect, MAX_FIFO_SIZE) != 0)
+    if(memcmp(data->ring->data, bufToExpect, TEST_FIFO_SIZE) != 0)
     {
         easyMock_addError(easyMock_true, "tested function didn't update data.data correctly. data->data != bufToExpect");
     }
 }
 
+/*
+ * Expects the user data to be copied in the ring at writeOffset with page faults disabled. Two copies are expected
+ * when the data wraps.
+ */
+static void expect_copy_from_user(struct simple_fifo_ring* ring, size_t writeOffset, char* buf, size_t len)
+{
+    size_t start = writeOffset & (ring->capacity - 1);
+    size_t firstLen = len < ring->capacity - start ? len : ring->capacity - start;
+
+    pagefault_disable_ExpectAndReturn();
+    copy_from_user_ExpectReturnAndOutput(&ring->data[start], buf, firstLen, 0, cmp_pointer, cmp_pointer, cmp_long, buf, firstLen);
+    if(firstLen < len)
+    {
+        copy_from_user_ExpectReturnAndOutput(ring->data, buf + firstLen, len - firstLen, 0, cmp_pointer, cmp_pointer, cmp_long, buf + firstLen, len - firstLen);
+    }
+    pagefault_enable_ExpectAndReturn();
+}
+
+static void expect_wake_up(wait_queue_head_t* wq_head, __poll_t events)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,9,0)
+    __wake_up_ExpectAndReturn(wq_head, TASK_INTERRUPTIBLE, 1, poll_to_key(events), 0, cmp_pointer, cmp_u_int, cmp_int, cmp_pointer);
+#else
+    __wake_up_ExpectAndReturn(wq_head, TASK_INTERRUPTIBLE, 1, poll_to_key(events), cmp_pointer, cmp_u_int, cmp_int, cmp_pointer);
+#endif
+}
+
+static void expect_wake_up_readers(struct simple_fifo_ring* ring)
+{
+    expect_wake_up(&ring->readWait, EPOLLIN | EPOLLRDNORM);
+}
+
+static void expect_wake_up_writers(struct simpleFifo_device_data* dev_data)
+{
+    expect_wake_up(&dev_data->writeWait, EPOLLOUT | EPOLLWRNORM);
+}
+
 static void test_INIT_LIST_HEAD(struct list_head *list)
 {
     list->next = list;
@@ -352,23 +776,66 @@ static void test_list_add_tail(struct list_head *new, struct list_head *head)
     _test_list_add(new, head->next, head);
 }
 
-static void prepare_for_each_files(unsigned int nb_files, unsigned int last_fail)
+static void expect_fault_in(char* buf, size_t len, size_t notFaultedIn)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,16,0)
+    fault_in_readable_ExpectAndReturn(buf, len, notFaultedIn, cmp_pointer, cmp_u_long);
+#else
+    fault_in_pages_readable_ExpectAndReturn(buf, len, notFaultedIn, cmp_pointer, cmp_int);
+#endif
+}
+
+static void expect_fault_in_writeable(char* buf, size_t len, size_t notFaultedIn)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,16,0)
+    fault_in_writeable_ExpectAndReturn(buf, len, notFaultedIn, cmp_pointer, cmp_u_long);
+#else
+    fault_in_pages_writeable_ExpectAndReturn(buf, len, notFaultedIn != 0 ? -EFAULT : 0, cmp_pointer, cmp_int);
+#endif
+}
+
+/*
+ * Expects the walk of the reader list copying the data in each ring. The user data is only copied in the first
+ * receiving ring, at writeOffset. Each reader is woken up after the new data has been committed in its ring.
+ */
+static void expect_fan_out(struct file_private_data* fpd, unsigned int nb_files, struct file_private_data* skipped_fpd,
+                           char* buf, size_t len, size_t writeOffset)
 {
-#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,15,46)
+    int copiedFromUser = 0;
+
     for(unsigned int file_idx = 0; file_idx < nb_files; ++file_idx)
     {
-        list_is_head_ExpectAndReturn(NULL, NULL, 0, NULL, NULL);
-    }
-    if(!last_fail)
-    {
-        list_is_head_ExpectAndReturn(NULL, NULL, 1, NULL, NULL);
+        if(&fpd[file_idx] != skipped_fpd)
+        {
+            if(!copiedFromUser)
+            {
+                expect_copy_from_user(fpd[file_idx].ring, writeOffset, buf, len);
+                copiedFromUser = 1;
+            }
+            expect_wake_up_readers(fpd[file_idx].ring);
+        }
     }
-#endif
+}
+
+static void prepare_ring(struct file_private_data* fpd, uint8_t* ring)
+{
+    memset(ring, 0, TEST_FIFO_SIZE);
+    fpd->privateRing.data = ring;
+    fpd->privateRing.capacity = TEST_FIFO_SIZE;
+    fpd->privateRing.writeOffset = 0;
+    fpd->ring = &fpd->privateRing;
+}
+
+static void set_pending(struct file_private_data* fpd, size_t readOffset, size_t size)
+{
+    fpd->readOffset = readOffset;
+    fpd->ring->writeOffset = readOffset + size;
 }
 
 static void prepare_one_file(struct simpleFifo_device_data* dev_data, struct file* file, struct file_private_data* fpd)
 {
     test_INIT_LIST_HEAD(&dev_data->opened_file_list);
+    prepare_ring(fpd, test_rings[0]);
     fpd->parent = dev_data;
     test_list_add_tail(&fpd->file_entry, &dev_data->opened_file_list);
     file->private_data = (void*)fpd;
@@ -379,6 +846,7 @@ static void prepare_write_two_file(struct simpleFifo_device_data* dev_data, stru
     test_INIT_LIST_HEAD(&dev_data->opened_file_list);
     for(uint8_t idx = 0; idx < 2; ++idx)
     {
+        prepare_ring(&fpd[idx], test_rings[idx]);
         fpd[idx].parent = dev_data;
         test_list_add_tail(&fpd[idx].file_entry, &dev_data->opened_file_list);
     }
@@ -386,19 +854,19 @@ static void prepare_write_two_file(struct simpleFifo_device_data* dev_data, stru
 
 int test_simple_fifo_write_simple_write()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
     prepare_one_file(&dev_data, &file, &fpd);
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, len, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, len);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd, 1, NULL, buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != len)
@@ -411,21 +879,21 @@ int test_simple_fifo_write_simple_write()
 
 static int test_write_file(int n)
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file_private_data fpd[2] = {{0}, {0}};
     prepare_write_two_file(&dev_data, fpd);
 
     struct file file = {0};
     file.private_data = &fpd[n];
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, len, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, len);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(fpd, 2, NULL, buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != len)
@@ -451,30 +919,29 @@ int test_simple_fifo_write_simple_write_two_files_write_second_file()
 
 int test_simple_fifo_write_wrapper_write()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
     prepare_one_file(&dev_data, &file, &fpd);
 
-    fpd.writeOffset = MAX_FIFO_SIZE - 4;
-    fpd.readOffset = fpd.writeOffset;
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    set_pending(&fpd, TEST_FIFO_SIZE - 4, 0);
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, &buf, len, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &buf, len);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd, 1, NULL, buf, len, TEST_FIFO_SIZE - 4);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != len)
     {
         easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", len);
     }
-    uint8_t offsetToExpect = 7;
-    char bufToExpect[MAX_FIFO_SIZE] = {0};
+    size_t offsetToExpect = TEST_FIFO_SIZE + 7;
+    char bufToExpect[TEST_FIFO_SIZE] = {0};
     bufToExpect[60] = 's';
     bufToExpect[61] = 'i';
     bufToExpect[62] = 'm';
@@ -492,26 +959,26 @@ int test_simple_fifo_write_wrapper_write()
 
 int test_simple_fifo_write_double_write()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
     prepare_one_file(&dev_data, &file, &fpd);
 
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, len, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, len);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd, 1, NULL, buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, len, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, len);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd, 1, NULL, buf, len, len);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != len)
@@ -523,92 +990,220 @@ int test_simple_fifo_write_double_write()
     {
         easyMock_addError(easyMock_true, "Call 2 of simple_fifo_write didn't return len (%zd)", len);
     }
-    char bufToExpect[MAX_FIFO_SIZE] = "simple charsimple char";
+    char bufToExpect[TEST_FIFO_SIZE] = "simple charsimple char";
     check_result(&fpd, len * 2, 0, len * 2, bufToExpect);
     return 0;
 }
 
 int test_simple_fifo_write_copy_from_user_fails()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
     prepare_one_file(&dev_data, &file, &fpd);
 
-    fpd.writeOffset = MAX_FIFO_SIZE - 4;
-    fpd.readOffset = fpd.writeOffset;
+    set_pending(&fpd, TEST_FIFO_SIZE - 4, 0);
 
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, &buf, len, 1, cmp_not_null_pointer, cmp_pointer, cmp_long, &buf, len);
-
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    pagefault_disable_ExpectAndReturn();
+    copy_from_user_ExpectReturnAndOutput(&fpd.ring->data[TEST_FIFO_SIZE - 4], buf, 4, 1, cmp_pointer, cmp_pointer, cmp_long, buf, 4);
+    pagefault_enable_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    expect_fault_in(buf, len, len);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != -EFAULT)
     {
         easyMock_addError(easyMock_true, "simple_fifo_write didn't return an error");
     }
-    check_result(&fpd, fpd.size, fpd.readOffset, fpd.writeOffset, &fpd.data);
+    check_result(&fpd, 0, TEST_FIFO_SIZE - 4, TEST_FIFO_SIZE - 4, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_write_fault_in_retry()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    // The user page is not present on the first attempt
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    pagefault_disable_ExpectAndReturn();
+    copy_from_user_ExpectReturnAndOutput(fpd.ring->data, buf, len, len, cmp_pointer, cmp_pointer, cmp_long, buf, 0);
+    pagefault_enable_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    expect_fault_in(buf, len, 0);
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd, 1, NULL, buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    check_result(&fpd, len, 0, len, buf);
     return 0;
 }
 
 int test_simple_fifo_write_fifo_full()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
     prepare_one_file(&dev_data, &file, &fpd);
+    file.f_flags |= O_NONBLOCK;
 
-    fpd.writeOffset = MAX_FIFO_SIZE - 1;
-    fpd.size = MAX_FIFO_SIZE;
+    set_pending(&fpd, 0, TEST_FIFO_SIZE);
 
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EAGAIN (%zd)", rv);
+    }
+    check_result(&fpd, TEST_FIFO_SIZE, 0, TEST_FIFO_SIZE, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_write_cached_writable()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    set_pending(&fpd, 16, 0);
+    char buf[TEST_FIFO_SIZE] = "12345678";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    // The readers are walked once, the space left is then kept for the next writes
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd, 1, NULL, buf, len, 16);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    if(dev_data.writableReaders != &dev_data.opened_file_list || dev_data.writable != TEST_FIFO_SIZE - (size_t)len)
+    {
+        easyMock_addError(easyMock_true, "the space left hasn't been cached (%zu)", dev_data.writable);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_readers_changed()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_flags |= O_NONBLOCK;
+    set_pending(&fpd, 0, TEST_FIFO_SIZE - 4);
+    // The cached space predates a change of the readers
+    dev_data.writable = TEST_FIFO_SIZE;
+    dev_data.writableReaders = &dev_data.opened_file_list;
+    atomic_set(&dev_data.readersGeneration, 1);
+    char buf[TEST_FIFO_SIZE] = "12345678";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EAGAIN (%zd)", rv);
+    }
+    if(dev_data.writable != 4 || dev_data.writableGeneration != 1)
+    {
+        easyMock_addError(easyMock_true, "the readers haven't been walked again (%zu)", dev_data.writable);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_zero_size()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+
+    set_pending(&fpd, 0, TEST_FIFO_SIZE);
+
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    loff_t offset;
+
+    // A zero size write never blocks, even if the fifo is full.
+    ssize_t rv = simple_fifo_write(&file, buf, 0, &offset);
     if(rv != 0)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_write didn't return 0");
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return 0 (%zd)", rv);
     }
-    check_result(&fpd, fpd.size, fpd.readOffset, fpd.writeOffset, &fpd.data);
+    check_result(&fpd, TEST_FIFO_SIZE, 0, TEST_FIFO_SIZE, fpd.ring->data);
     return 0;
 }
 
 int test_simple_fifo_write_fifo_partial_write()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
     prepare_one_file(&dev_data, &file, &fpd);
+    file.f_flags |= O_NONBLOCK;
 
-    fpd.writeOffset = 10;
-    fpd.size = MAX_FIFO_SIZE - 4;
+    set_pending(&fpd, 14, TEST_FIFO_SIZE - 4);
 
-    char buf[MAX_FIFO_SIZE] = "simple char";
-    ssize_t len = strlen(buf);
+    // Only a write bigger than SIMPLE_FIFO_ATOMIC_SIZE can be partial
+    char buf[SIMPLE_FIFO_ATOMIC_SIZE + 1] = "simple char";
+    ssize_t len = sizeof(buf);
     loff_t offset;
 
     // First write
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, 4, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, 4);
-    prepare_for_each_files(1, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd, 1, NULL, buf, 4, TEST_FIFO_SIZE + 10);
+    rcu_read_unlock_ExpectAndReturn();
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     // Second write
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(1, DO_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != 4)
@@ -616,86 +1211,162 @@ int test_simple_fifo_write_fifo_partial_write()
         easyMock_addError(easyMock_true, "simple_fifo_write didn't return partial write of 4 (%zd)", len);
     }
     rv = simple_fifo_write(&file, buf, len, &offset);
-    if(rv != 0)
+    if(rv != -EAGAIN)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_write didn't return 0 after partial write");
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EAGAIN after partial write (%zd)", rv);
     }
-    uint8_t dataToExpect[MAX_FIFO_SIZE] = {0};
+    uint8_t dataToExpect[TEST_FIFO_SIZE] = {0};
     dataToExpect[10] = 's';
     dataToExpect[11] = 'i';
     dataToExpect[12] = 'm';
     dataToExpect[13] = 'p';
-    check_result(&fpd, MAX_FIFO_SIZE, 0, 14, dataToExpect);
+    check_result(&fpd, TEST_FIFO_SIZE, 14, TEST_FIFO_SIZE + 14, dataToExpect);
+    return 0;
+}
+
+int test_simple_fifo_write_atomic_no_room()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_flags |= O_NONBLOCK;
+
+    set_pending(&fpd, 14, TEST_FIFO_SIZE - 4);
+
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    // A write of up to SIMPLE_FIFO_ATOMIC_SIZE bytes is never split
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EAGAIN (%zd)", rv);
+    }
+    check_result(&fpd, TEST_FIFO_SIZE - 4, 14, TEST_FIFO_SIZE + 10, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_write_full_length()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.policy = SIMPLE_FIFO_POLICY_DROP_OLDEST;
+
+    char buf[SIMPLE_FIFO_ATOMIC_SIZE + TEST_FIFO_SIZE / 2];
+    ssize_t len = sizeof(buf);
+    loff_t offset;
+    for(size_t idx = 0; idx < sizeof(buf); ++idx)
+    {
+        buf[idx] = 'a' + idx % 26;
+    }
+
+    // The write goes on ring after ring without releasing write_mutex
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    for(size_t written = 0; written < sizeof(buf); written += TEST_FIFO_SIZE)
+    {
+        size_t chunk = sizeof(buf) - written < TEST_FIFO_SIZE ? sizeof(buf) - written : TEST_FIFO_SIZE;
+
+        rcu_read_lock_ExpectAndReturn();
+        expect_fan_out(&fpd, 1, NULL, buf + written, chunk, written);
+        rcu_read_unlock_ExpectAndReturn();
+    }
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't write everything (%zd)", rv);
+    }
+    uint8_t dataToExpect[TEST_FIFO_SIZE];
+    for(size_t idx = 0; idx < TEST_FIFO_SIZE; ++idx)
+    {
+        size_t bufOffset = sizeof(buf) - TEST_FIFO_SIZE + idx;
+        dataToExpect[bufOffset & (TEST_FIFO_SIZE - 1)] = buf[bufOffset];
+    }
+    check_result(&fpd, TEST_FIFO_SIZE, len - TEST_FIFO_SIZE, len, dataToExpect);
     return 0;
 }
 
 int test_simple_fifo_write_fifo_write_first_file_second_is_full()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file_private_data fpd[2] = {{0}, {0}};
     prepare_write_two_file(&dev_data, fpd);
 
     // Write first file
     struct file file = {0};
     file.private_data = &fpd[0];
+    file.f_flags |= O_NONBLOCK;
 
     // Second is full
-    memset(&fpd[1].data, 'a', MAX_FIFO_SIZE);
-    fpd[1].writeOffset = MAX_FIFO_SIZE - 1;
-    fpd[1].size = MAX_FIFO_SIZE;
+    memset(fpd[1].ring->data, 'a', TEST_FIFO_SIZE);
+    set_pending(&fpd[1], 0, TEST_FIFO_SIZE);
 
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(2, DO_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
-    if(rv != 0)
+    if(rv != -EAGAIN)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_write didn't return 0");
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EAGAIN (%zd)", rv);
     }
 
     // First queue remains empty
-    check_result(&fpd[0], 0, 0, 0, &fpd[0].data);
+    check_result(&fpd[0], 0, 0, 0, fpd[0].ring->data);
 
     // First queue remains full
-    check_result(&fpd[1], MAX_FIFO_SIZE, 0, MAX_FIFO_SIZE - 1, &fpd[1].data);
+    check_result(&fpd[1], TEST_FIFO_SIZE, 0, TEST_FIFO_SIZE, fpd[1].ring->data);
 
     return 0;
 }
 
 int test_simple_fifo_write_fifo_write_first_file_second_is_partial_write()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file_private_data fpd[2] = {{0}, {0}};
     prepare_write_two_file(&dev_data, fpd);
 
     // Write first file
     struct file file = {0};
     file.private_data = &fpd[0];
+    file.f_flags |= O_NONBLOCK;
 
     // Second is partial
-    fpd[1].writeOffset = 10;
-    fpd[1].size = MAX_FIFO_SIZE - 4;
+    set_pending(&fpd[1], 14, TEST_FIFO_SIZE - 4);
 
-    char buf[MAX_FIFO_SIZE] = "simple char";
-    ssize_t len = strlen(buf);
+    char buf[SIMPLE_FIFO_ATOMIC_SIZE + 1] = "simple char";
+    ssize_t len = sizeof(buf);
     loff_t offset;
 
     // First write
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, 4, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, 4);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(fpd, 2, NULL, buf, 4, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     // Second write
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(2, DO_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != 4)
@@ -703,51 +1374,55 @@ int test_simple_fifo_write_fifo_write_first_file_second_is_partial_write()
         easyMock_addError(easyMock_true, "simple_fifo_write didn't return partial write of 4 (%zd)", len);
     }
     rv = simple_fifo_write(&file, buf, len, &offset);
-    if(rv != 0)
+    if(rv != -EAGAIN)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_write didn't return 0 after partial write");
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EAGAIN after partial write (%zd)", rv);
     }
 
-    uint8_t file1dataToExpect[MAX_FIFO_SIZE] = {0};
+    uint8_t file1dataToExpect[TEST_FIFO_SIZE] = {0};
     file1dataToExpect[0] = 's';
     file1dataToExpect[1] = 'i';
     file1dataToExpect[2] = 'm';
     file1dataToExpect[3] = 'p';
     check_result(&fpd[0], 4, 0, 4, file1dataToExpect);
 
-    uint8_t file2dataToExpect[MAX_FIFO_SIZE] = {0};
+    uint8_t file2dataToExpect[TEST_FIFO_SIZE] = {0};
     file2dataToExpect[10] = 's';
     file2dataToExpect[11] = 'i';
     file2dataToExpect[12] = 'm';
     file2dataToExpect[13] = 'p';
-    check_result(&fpd[1], MAX_FIFO_SIZE, 0, 14, file2dataToExpect);
+    check_result(&fpd[1], TEST_FIFO_SIZE, 14, TEST_FIFO_SIZE + 14, file2dataToExpect);
     return 0;
 }
 
 int test_simple_fifo_write_fifo_write_two_file_big_data()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file_private_data fpd[2] = {{0}, {0}};
     prepare_write_two_file(&dev_data, fpd);
 
     // Write first file
     struct file file = {0};
     file.private_data = &fpd[0];
+    file.f_flags |= O_NONBLOCK;
 
-    char buf[] = "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
-    ssize_t len = strlen(buf);
+    char buf[SIMPLE_FIFO_ATOMIC_SIZE + 1] = "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz";
+    ssize_t len = sizeof(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, MAX_FIFO_SIZE, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, MAX_FIFO_SIZE);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    // The rings are filled, then the writer would have to wait for the readers
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(fpd, 2, NULL, buf, TEST_FIFO_SIZE, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
-    if(rv != MAX_FIFO_SIZE)
+    if(rv != TEST_FIFO_SIZE)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_write didn't return MAX_FIFO_SIZE != (%zd)", len);
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return TEST_FIFO_SIZE != (%zd)", len);
     }
 
     return 0;
@@ -755,229 +1430,2330 @@ int test_simple_fifo_write_fifo_write_two_file_big_data()
 
 int test_simple_fifo_write_fifo_write_two_file_one_is_write_only()
 {
-    struct simpleFifo_device_data dev_data;
-    struct file_private_data fpd[2] = {{0}, {0}};
-    prepare_write_two_file(&dev_data, fpd);
-
+    struct simpleFifo_device_data dev_data = {0};
+    struct file readerFile = {0};
+    struct file_private_data readerFpd = {0};
+    prepare_one_file(&dev_data, &readerFile, &readerFpd);
+
+    // A write only file has no ring and is not in the list of opened files
+    struct file_private_data writerFpd = {0};
+    writerFpd.parent = &dev_data;
     struct file file = {0};
     file.f_flags |= O_WRONLY;
-    file.private_data = &fpd[0];
-    char buf[MAX_FIFO_SIZE] = "simple char";
+    file.private_data = &writerFpd;
+    char buf[TEST_FIFO_SIZE] = "simple char";
     ssize_t len = strlen(buf);
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    copy_from_user_ExpectReturnAndOutput(NULL, buf, len, 0, cmp_not_null_pointer, cmp_pointer, cmp_long, buf, len);
-    prepare_for_each_files(2, DO_NOT_FAIL);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&readerFpd, 1, NULL, buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
     ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != len)
     {
         easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", len);
     }
-
-    char expectedBuf0[MAX_FIFO_SIZE] = {0};
-    check_result(&fpd[0], 0, 0, 0, expectedBuf0);
-    check_result(&fpd[1], len, 0, len, buf);
+    check_result(&readerFpd, len, 0, len, buf);
     return 0;
 }
 
-int test_simple_fifo_read_simple_read()
+static void prepare_broadcast_two_file(struct simpleFifo_device_data* dev_data, struct file_private_data* fpd)
 {
-    struct simpleFifo_device_data dev_data;
-    struct file file = {0};
-    struct file_private_data fpd = {0};
-    prepare_one_file(&dev_data, &file, &fpd);
+    test_INIT_LIST_HEAD(&dev_data->opened_file_list);
+    memset(test_rings[0], 0, TEST_FIFO_SIZE);
+    dev_data->broadcast = true;
+    dev_data->sharedRing.data = test_rings[0];
+    dev_data->sharedRing.capacity = TEST_FIFO_SIZE;
+    dev_data->sharedRing.writeOffset = 0;
+    for(uint8_t idx = 0; idx < 2; ++idx)
+    {
+        fpd[idx].ring = &dev_data->sharedRing;
+        fpd[idx].readOffset = 0;
+        fpd[idx].parent = dev_data;
+        test_list_add_tail(&fpd[idx].file_entry, &dev_data->opened_file_list);
+    }
+}
 
-    char bufToReturn[] = "simple char";
-    ssize_t len = strlen(bufToReturn) + 1;
-    snprintf((char*)fpd.data, MAX_FIFO_SIZE, "%s", bufToReturn);
-    fpd.writeOffset = len;
-    fpd.readOffset = fpd.writeOffset - len;
-    fpd.size = len;
-    char buf = '\0';
+int test_simple_fifo_write_broadcast_two_files()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
+
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
     loff_t offset;
-    uint8_t expectedReadOffset = fpd.readOffset + fpd.size;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    copy_to_user_ExpectAndReturn(&buf, bufToReturn, len, 0, cmp_pointer, cmp_str, cmp_long);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    // The data is copied once in the shared ring so the list is walked only once to check the available space
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, dev_data.sharedRing.writeOffset, buf, len);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
-    ssize_t rv = simple_fifo_read(&file, &buf, len, &offset);
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
     if(rv != len)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len (%zd)", len);
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", len);
+    }
+    for(uint8_t idx = 0; idx < 2; ++idx)
+    {
+        check_result(&fpd[idx], len, 0, len, buf);
     }
-    check_result(&fpd, 0, expectedReadOffset, len, &fpd.data);
     return 0;
 }
 
-int test_simple_fifo_read_double_read()
+int test_simple_fifo_write_broadcast_slowest_reader_limits_write()
 {
-    struct simpleFifo_device_data dev_data;
-    struct file file = {0};
-    struct file_private_data fpd = {0};
-    prepare_one_file(&dev_data, &file, &fpd);
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
 
-    char firstBufToReturn[] = "simple char";
-    char secondBufToReturn[] = "and another one";
-    ssize_t firstBufLen = strlen(firstBufToReturn) + 1;
-    ssize_t secondBufLen = strlen(secondBufToReturn) + 1;
-    ssize_t fifoSize = firstBufLen + secondBufLen;
-    snprintf((char*)fpd.data, MAX_FIFO_SIZE, "%s%c%s", firstBufToReturn, '\0', secondBufToReturn);
-    fpd.writeOffset = fifoSize;
-    fpd.readOffset = fpd.writeOffset - fifoSize;
-    fpd.size = fifoSize;
-    char buf = '\0';
+    // The second reader has consumed everything, the first one still has 60 bytes pending
+    dev_data.sharedRing.writeOffset = TEST_FIFO_SIZE - 4;
+    fpd[1].readOffset = TEST_FIFO_SIZE - 4;
+
+    struct file file = {0};
+    file.private_data = &fpd[1];
+    file.f_flags |= O_NONBLOCK;
+    char buf[SIMPLE_FIFO_ATOMIC_SIZE + 1] = "simple char";
+    ssize_t len = sizeof(buf);
     loff_t offset;
-    uint8_t expectedReadOffset = fpd.readOffset + fpd.size;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    copy_to_user_ExpectAndReturn(&buf, firstBufToReturn, firstBufLen, 0, cmp_pointer, cmp_str, cmp_long);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    copy_to_user_ExpectAndReturn(&buf, secondBufToReturn, secondBufLen, 0, cmp_pointer, cmp_str, cmp_long);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, dev_data.sharedRing.writeOffset, buf, 4);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
-    ssize_t rv = simple_fifo_read(&file, &buf, firstBufLen, &offset);
-    if(rv != firstBufLen)
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != 4)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len on call 1 (%zd)", firstBufLen);
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return partial write of 4 (%zd)", rv);
     }
-    rv = simple_fifo_read(&file, &buf, secondBufLen, &offset);
-    if(rv != secondBufLen)
+    if(dev_data.sharedRing.writeOffset != TEST_FIFO_SIZE)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len on call 2(%zd)", secondBufLen);
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't update the shared ring write offset (%zu)", dev_data.sharedRing.writeOffset);
     }
-    check_result(&fpd, 0, expectedReadOffset, fpd.writeOffset, &fpd.data);
     return 0;
 }
 
-int test_simple_fifo_read_empty_fifo()
+int test_simple_fifo_write_broadcast_all_detached()
 {
-    struct simpleFifo_device_data dev_data;
-    struct file file = {0};
-    struct file_private_data fpd = {0};
-    prepare_one_file(&dev_data, &file, &fpd);
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    fpd[0].detached = true;
+    fpd[1].detached = true;
 
-    char buf = '\0';
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    char buf[TEST_FIFO_SIZE + 8];
+    memset(buf, 'a', sizeof(buf));
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-
-    ssize_t rv = simple_fifo_read(&file, &buf, 42, &offset);
-    if(rv != 0)
+    // No reader bounds the write, it is still stored one shared ring at a time
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, 0, buf, TEST_FIFO_SIZE);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, TEST_FIFO_SIZE, buf + TEST_FIFO_SIZE, 8);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, sizeof(buf), &offset);
+    if(rv != (ssize_t)sizeof(buf) || dev_data.sharedRing.writeOffset != sizeof(buf))
     {
-        easyMock_addError(easyMock_true, "simple_fifo_read didn't return 0");
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't write the buffer one ring at a time (%zd)", rv);
     }
-    check_result(&fpd, 0, 0, 0, &fpd.data);
     return 0;
 }
 
-int test_simple_fifo_read_wrap_read()
+static void prepare_broadcast_write_only(struct simpleFifo_device_data* dev_data, struct file* file, struct file_private_data* fpd)
 {
-    char dataBuf[MAX_FIFO_SIZE] = {0};
-    dataBuf[60] = 's';
-    dataBuf[61] = 'i';
-    dataBuf[62] = 'm';
-    dataBuf[63] = 'p';
-    dataBuf[ 0] = 'l';
-    dataBuf[ 1] = 'e';
-    dataBuf[ 2] = ' ';
-    dataBuf[ 3] = 'c';
-    dataBuf[ 4] = 'h';
-    dataBuf[ 5] = 'a';
-    dataBuf[ 6] = 'r';
-    dataBuf[ 7] = '\0';
-    struct simpleFifo_device_data dev_data;
+    test_INIT_LIST_HEAD(&dev_data->opened_file_list);
+    memset(test_rings[0], 0, TEST_FIFO_SIZE);
+    dev_data->broadcast = true;
+    dev_data->sharedRing.data = test_rings[0];
+    dev_data->sharedRing.capacity = TEST_FIFO_SIZE;
+    fpd->parent = dev_data;
+    file->f_flags = O_WRONLY;
+    file->private_data = fpd;
+}
+
+int test_simple_fifo_write_broadcast_no_reader()
+{
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
-    prepare_one_file(&dev_data, &file, &fpd);
-
-    memcpy(fpd.data, dataBuf, MAX_FIFO_SIZE);
-    fpd.writeOffset = 8;
-    fpd.readOffset = 60;
-    fpd.size = 12;
-
-    char bufToExpect[] = "simple char";
-
-    char buf = '\0';
-    ssize_t len = strlen(bufToExpect)+1;
+    prepare_broadcast_write_only(&dev_data, &file, &fpd);
+    char buf[TEST_FIFO_SIZE + 8];
+    memset(buf, 'a', sizeof(buf));
     loff_t offset;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    copy_to_user_ExpectAndReturn(&buf, bufToExpect, len, 0, cmp_pointer, cmp_str, cmp_long);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-
-    ssize_t rv = simple_fifo_read(&file, &buf, len, &offset);
-    if(rv != len)
+    // Without any reader the write is still bounded by the capacity of the shared ring
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, 0, buf, TEST_FIFO_SIZE);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, TEST_FIFO_SIZE, buf + TEST_FIFO_SIZE, 8);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, sizeof(buf), &offset);
+    if(rv != (ssize_t)sizeof(buf) || dev_data.sharedRing.writeOffset != sizeof(buf))
     {
-        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len (%zd != %zd)", rv, len);
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't write the buffer one ring at a time (%zd)", rv);
     }
-    check_result(&fpd, 0, 8, 8, dataBuf);
     return 0;
 }
 
-int test_simple_fifo_read_request_too_big()
+int test_simple_fifo_write_broadcast_no_reader_record_too_big()
 {
-    struct simpleFifo_device_data dev_data;
+    struct simpleFifo_device_data dev_data = {0};
     struct file file = {0};
     struct file_private_data fpd = {0};
-    prepare_one_file(&dev_data, &file, &fpd);
-
-    char bufToReturn[] = "simple char";
-    ssize_t len = strlen(bufToReturn) + 1;
-    snprintf((char*)fpd.data, MAX_FIFO_SIZE, "%s", bufToReturn);
-    fpd.writeOffset = len;
-    fpd.readOffset = fpd.writeOffset - len;
-    fpd.size = len;
-
-    char buf = '\0';
+    prepare_broadcast_write_only(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    char buf[TEST_FIFO_SIZE];
+    memset(buf, 'a', sizeof(buf));
     loff_t offset;
-    uint8_t expectedReadOffset = fpd.readOffset + fpd.size;
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    copy_to_user_ExpectAndReturn(&buf, bufToReturn, len, 0, cmp_pointer, cmp_str, cmp_long);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    // The header and the payload can't fit in the shared ring
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
 
-    ssize_t rv = simple_fifo_read(&file, &buf, 30, &offset);
-    if(rv != len)
+    ssize_t rv = simple_fifo_write(&file, buf, sizeof(buf), &offset);
+    if(rv != -EMSGSIZE || dev_data.sharedRing.writeOffset != 0)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len (%zd)", len);
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EMSGSIZE (%zd)", rv);
     }
-    check_result(&fpd, 0, expectedReadOffset, len, &fpd.data);
     return 0;
 }
 
-int test_simple_fifo_read_copy_to_user_fails()
+/*
+ * Writes the first file while the ring of the second one is full, its policy deciding what happens to the data.
+ */
+static void prepare_second_file_full(struct simpleFifo_device_data* dev_data, struct file_private_data* fpd, unsigned int policy)
 {
-    struct simpleFifo_device_data dev_data;
-    struct file file = {0};
-    struct file_private_data fpd = {0};
-    prepare_one_file(&dev_data, &file, &fpd);
+    prepare_write_two_file(dev_data, fpd);
+    memset(fpd[1].ring->data, 'a', TEST_FIFO_SIZE);
+    set_pending(&fpd[1], 0, TEST_FIFO_SIZE);
+    fpd[1].policy = policy;
+}
+
+int test_simple_fifo_write_drop_oldest()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_second_file_full(&dev_data, fpd, SIMPLE_FIFO_POLICY_DROP_OLDEST);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+    uint8_t expectedRing[TEST_FIFO_SIZE];
+    memset(expectedRing, 'a', TEST_FIFO_SIZE);
+    memcpy(expectedRing, buf, len);
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(fpd, 2, NULL, buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    check_result(&fpd[0], len, 0, len, buf);
+    // The oldest data of the second file has been overwritten
+    check_result(&fpd[1], TEST_FIFO_SIZE, len, TEST_FIFO_SIZE + len, expectedRing);
+    return 0;
+}
+
+int test_simple_fifo_write_drop_newest()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_second_file_full(&dev_data, fpd, SIMPLE_FIFO_POLICY_DROP_NEWEST);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(fpd, 2, &fpd[1], buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    check_result(&fpd[0], len, 0, len, buf);
+    // The second file didn't receive the data
+    check_result(&fpd[1], TEST_FIFO_SIZE, 0, TEST_FIFO_SIZE, fpd[1].ring->data);
+    return 0;
+}
+
+int test_simple_fifo_write_detach()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_second_file_full(&dev_data, fpd, SIMPLE_FIFO_POLICY_DETACH);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(fpd[0].ring, 0, buf, len);
+    expect_wake_up_readers(fpd[0].ring);
+    expect_wake_up(&fpd[1].ring->readWait, EPOLLHUP);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    if(!fpd[1].detached)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't detach the second file");
+    }
+    check_result(&fpd[0], len, 0, len, buf);
+    return 0;
+}
+
+int test_simple_fifo_write_broadcast_drop_oldest()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
+
+    // The first reader hasn't consumed anything, the second one is up to date
+    dev_data.sharedRing.writeOffset = TEST_FIFO_SIZE;
+    fpd[0].policy = SIMPLE_FIFO_POLICY_DROP_OLDEST;
+    fpd[1].readOffset = TEST_FIFO_SIZE;
+
+    struct file file = {0};
+    file.private_data = &fpd[1];
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, TEST_FIFO_SIZE, buf, len);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    if(fpd[0].readOffset != (size_t)len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't drop the oldest data of the first reader (%zu)", fpd[0].readOffset);
+    }
+    return 0;
+}
+
+/*
+ * Links a channel in the channel table of the device like hash_add() would.
+ */
+static void prepare_channel(struct simpleFifo_device_data* dev_data, struct simple_fifo_channel* channel, const char* name, unsigned int refCount)
+{
+    struct hlist_head* bucket = &dev_data->channels[hash_min(jhash(name, strlen(name), 0), SIMPLE_FIFO_CHANNEL_HASH_BITS)];
+
+    strcpy(channel->name, name);
+    channel->refCount = refCount;
+    test_INIT_LIST_HEAD(&channel->opened_file_list);
+    channel->node.next = bucket->first;
+    channel->node.pprev = &bucket->first;
+    bucket->first = &channel->node;
+}
+
+int test_simple_fifo_write_channel()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    struct simple_fifo_channel channel = {0};
+    prepare_write_two_file(&dev_data, fpd);
+    prepare_channel(&dev_data, &channel, "news", 1);
+
+    // The second file is moved to the channel, the first one stays a reader of the device
+    fpd[1].file_entry.prev->next = fpd[1].file_entry.next;
+    fpd[1].file_entry.next->prev = fpd[1].file_entry.prev;
+    test_list_add_tail(&fpd[1].file_entry, &channel.opened_file_list);
+    fpd[1].channel = &channel;
+
+    struct file file = {0};
+    file.private_data = &fpd[1];
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_fan_out(&fpd[1], 1, NULL, buf, len, 0);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    check_result(&fpd[1], len, 0, len, buf);
+    if(fpd[0].ring->writeOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write wrote to a reader of another channel");
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_broadcast_channel()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    struct simple_fifo_channel channel = {0};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    prepare_channel(&dev_data, &channel, "news", 1);
+    memset(test_rings[1], 0, TEST_FIFO_SIZE);
+    channel.ring.data = test_rings[1];
+    channel.ring.capacity = TEST_FIFO_SIZE;
+
+    // The second file is moved to the channel and reads its shared ring
+    fpd[1].file_entry.prev->next = fpd[1].file_entry.next;
+    fpd[1].file_entry.next->prev = fpd[1].file_entry.prev;
+    test_list_add_tail(&fpd[1].file_entry, &channel.opened_file_list);
+    fpd[1].channel = &channel;
+    fpd[1].ring = &channel.ring;
+
+    struct file file = {0};
+    file.private_data = &fpd[1];
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    // The data is stored once, in the ring of the channel
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&channel.ring, 0, buf, len);
+    expect_wake_up_readers(&channel.ring);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    check_result(&fpd[1], len, 0, len, buf);
+    if(dev_data.sharedRing.writeOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write wrote to the ring of the device");
+    }
+    return 0;
+}
+
+/*
+ * Stores a record holding payload and its terminating NUL in the ring of the file at offset. Returns the offset
+ * following the record.
+ */
+static size_t put_record(struct file_private_data* fpd, size_t offset, const char* payload)
+{
+    __u32 recordLen = strlen(payload) + 1;
+
+    simple_fifo_ring_copy_from_buf(fpd->ring, offset, (uint8_t const*)&recordLen, SIMPLE_FIFO_RECORD_HEADER);
+    simple_fifo_ring_copy_from_buf(fpd->ring, offset + SIMPLE_FIFO_RECORD_HEADER, (uint8_t const*)payload, recordLen);
+    return offset + SIMPLE_FIFO_RECORD_HEADER + recordLen;
+}
+
+int test_simple_fifo_write_record()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+    __u32 header;
+
+    // The payload follows the length of the record
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(fpd.ring, SIMPLE_FIFO_RECORD_HEADER, buf, len);
+    expect_wake_up_readers(fpd.ring);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    memcpy(&header, fpd.ring->data, sizeof(header));
+    if(header != len || fpd.ring->writeOffset != SIMPLE_FIFO_RECORD_HEADER + len ||
+       memcmp(fpd.ring->data + SIMPLE_FIFO_RECORD_HEADER, buf, len) != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't store the record (header %u, writeOffset %zu)", header, fpd.ring->writeOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_record_no_room()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    file.f_flags |= O_NONBLOCK;
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+    // One byte is missing for the record, it is not truncated
+    set_pending(&fpd, 0, TEST_FIFO_SIZE - SIMPLE_FIFO_RECORD_HEADER - len + 1);
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EAGAIN (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_record_too_big()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    char buf[TEST_FIFO_SIZE] = {0};
+    ssize_t len = TEST_FIFO_SIZE - SIMPLE_FIFO_RECORD_HEADER + 1;
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != -EMSGSIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EMSGSIZE (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_record_drop_oldest()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file readerFile = {0};
+    struct file_private_data readerFpd = {0};
+    prepare_one_file(&dev_data, &readerFile, &readerFpd);
+    dev_data.recordMode = true;
+    readerFpd.policy = SIMPLE_FIFO_POLICY_DROP_OLDEST;
+    // Records of 36 and 24 bytes, headers included, leave 4 bytes free
+    size_t secondRecord = put_record(&readerFpd, 0, "0123456789abcdefghijklmnopqrstu");
+    readerFpd.ring->writeOffset = put_record(&readerFpd, secondRecord, "vwxyz0123456789abcd");
+
+    struct file_private_data writerFpd = {0};
+    writerFpd.parent = &dev_data;
+    struct file file = {0};
+    file.f_flags = O_WRONLY;
+    file.private_data = &writerFpd;
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    ssize_t len = strlen(buf);
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(readerFpd.ring, TEST_FIFO_SIZE, buf, len);
+    expect_wake_up_readers(readerFpd.ring);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return len (%zd)", rv);
+    }
+    // Only 11 bytes were needed but the whole first record is dropped
+    if(readerFpd.readOffset != secondRecord)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't drop a whole record (%zu != %zu)", readerFpd.readOffset, secondRecord);
+    }
+    if(readerFpd.ring->writeOffset != TEST_FIFO_SIZE + len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't store the record (%zu)", readerFpd.ring->writeOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_partial_slot()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.slotSize = 8;
+    char buf[TEST_FIFO_SIZE] = {0};
+    loff_t offset;
+
+    // Nothing is written for a write which isn't made of whole elements
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write(&file, buf, 12, &offset);
+    if(rv != -EINVAL || fpd.ring->writeOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return -EINVAL (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_iter()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    struct kiocb iocb = {0};
+    struct iov_iter iter = {0};
+    iocb.ki_filp = &file;
+    size_t len = 20;
+
+    // All the segments are copied at once, wrapping around the end of the ring
+    set_pending(&fpd, TEST_FIFO_SIZE - 4, 0);
+    iov_iter_count_ExpectAndReturn(&iter, len, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    pagefault_disable_ExpectAndReturn();
+    copy_from_iter_ExpectAndReturn(&fpd.ring->data[TEST_FIFO_SIZE - 4], 4, &iter, 4, cmp_pointer, cmp_u_long, cmp_pointer);
+    copy_from_iter_ExpectAndReturn(fpd.ring->data, len - 4, &iter, len - 4, cmp_pointer, cmp_u_long, cmp_pointer);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_readers(fpd.ring);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write_iter(&iocb, &iter);
+    if(rv != (ssize_t)len || fpd.ring->writeOffset != TEST_FIFO_SIZE - 4 + len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write_iter didn't write len (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_iter_fault()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    struct kiocb iocb = {0};
+    struct iov_iter iter = {0};
+    iocb.ki_filp = &file;
+    iocb.ki_flags = IOCB_NOWAIT;
+    size_t len = 20;
+
+    // The iterator is reverted and the user pages are not faulted in with IOCB_NOWAIT
+    iov_iter_count_ExpectAndReturn(&iter, len, cmp_pointer);
+    mutex_trylock_ExpectAndReturn(&dev_data.write_mutex, 1, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    pagefault_disable_ExpectAndReturn();
+    copy_from_iter_ExpectAndReturn(fpd.ring->data, len, &iter, 8, cmp_pointer, cmp_u_long, cmp_pointer);
+    iov_iter_revert_ExpectAndReturn(&iter, 8, cmp_pointer, cmp_u_long);
+    pagefault_enable_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write_iter(&iocb, &iter);
+    if(rv != -EAGAIN || fpd.ring->writeOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write_iter didn't return -EAGAIN (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_write_iter_nowait_locked()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    struct kiocb iocb = {0};
+    struct iov_iter iter = {0};
+    iocb.ki_filp = &file;
+    iocb.ki_flags = IOCB_NOWAIT;
+
+    // Another writer holds write_mutex
+    iov_iter_count_ExpectAndReturn(&iter, 20, cmp_pointer);
+    mutex_trylock_ExpectAndReturn(&dev_data.write_mutex, 0, cmp_pointer);
+
+    ssize_t rv = simple_fifo_write_iter(&iocb, &iter);
+    if(rv != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write_iter didn't return -EAGAIN (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_simple_read()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+
     char bufToReturn[] = "simple char";
     ssize_t len = strlen(bufToReturn) + 1;
-    snprintf((char*)fpd.data, MAX_FIFO_SIZE, "%s", bufToReturn);
-    fpd.writeOffset = len;
-    fpd.readOffset = fpd.writeOffset - len;
-    fpd.size = len;
+    snprintf((char*)fpd.ring->data, TEST_FIFO_SIZE, "%s", bufToReturn);
+    set_pending(&fpd, 0, len);
+    char buf = '\0';
+    loff_t offset;
+    size_t expectedReadOffset = fpd.ring->writeOffset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(&buf, bufToReturn, len, 0, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, &buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len (%zd)", len);
+    }
+    check_result(&fpd, 0, expectedReadOffset, len, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_read_record()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    size_t secondRecord = put_record(&fpd, 0, "hello");
+    fpd.ring->writeOffset = put_record(&fpd, secondRecord, "abc");
+    char buf[TEST_FIFO_SIZE];
+    loff_t offset;
+
+    // A single record is returned even though the buffer could hold both
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(buf, "hello", sizeof("hello"), 0, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, buf, sizeof(buf), &offset);
+    if(rv != sizeof("hello"))
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return the record length (%zd)", rv);
+    }
+    if(fpd.readOffset != secondRecord)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't consume the record (%zu != %zu)", fpd.readOffset, secondRecord);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_record_buffer_too_small()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    fpd.ring->writeOffset = put_record(&fpd, 0, "hello");
+    char buf[3];
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, buf, sizeof(buf), &offset);
+    if(rv != -EMSGSIZE || fpd.readOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return -EMSGSIZE and keep the record (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_record_beyond_pending()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    put_record(&fpd, 0, "hello");
+    // The header claims more data than what is pending
+    fpd.ring->writeOffset = SIMPLE_FIFO_RECORD_HEADER + 2;
+    char buf[TEST_FIFO_SIZE];
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, buf, sizeof(buf), &offset);
+    if(rv != -EIO)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return -EIO (%zd)", rv);
+    }
+    if(fpd.readOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read moved the read offset (%zu)", fpd.readOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_broadcast_overtaken()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    // A writer detached the file and wrapped the shared ring over its data once it was found attached
+    fpd[0].readOffset = 4;
+    dev_data.sharedRing.writeOffset = 4 + TEST_FIFO_SIZE + 8;
+    char buf[2 * TEST_FIFO_SIZE];
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, buf, sizeof(buf), &offset);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return 0 (%zd)", rv);
+    }
+    if(fpd[0].readOffset != 4)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read moved the read offset (%zu)", fpd[0].readOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_whole_slots()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.slotSize = 8;
+    set_pending(&fpd, 0, 24);
+    char buf[20];
+    loff_t offset;
+
+    // The buffer holds two elements and a half, only the two elements are read
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(buf, fpd.ring->data, 16, 0, cmp_pointer, cmp_pointer, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, buf, sizeof(buf), &offset);
+    if(rv != 16 || fpd.readOffset != 16)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't read whole elements (%zd, readOffset %zu)", rv, fpd.readOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_buffer_smaller_than_slot()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.slotSize = 8;
+    set_pending(&fpd, 0, 24);
+    char buf[4];
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, buf, sizeof(buf), &offset);
+    if(rv != -EMSGSIZE || fpd.readOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return -EMSGSIZE (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_iter()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    struct kiocb iocb = {0};
+    struct iov_iter iter = {0};
+    iocb.ki_filp = &file;
+    iocb.ki_flags = IOCB_NOWAIT;
+    set_pending(&fpd, TEST_FIFO_SIZE - 2, 10);
+
+    // The pending data wraps, it is scattered in the segments by two copies
+    iov_iter_count_ExpectAndReturn(&iter, 20, cmp_pointer);
+    mutex_trylock_ExpectAndReturn(&fpd.read_mutex, 1, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_iter_ExpectAndReturn(&fpd.ring->data[TEST_FIFO_SIZE - 2], 2, &iter, 2, cmp_pointer, cmp_u_long, cmp_pointer);
+    copy_to_iter_ExpectAndReturn(fpd.ring->data, 8, &iter, 8, cmp_pointer, cmp_u_long, cmp_pointer);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read_iter(&iocb, &iter);
+    if(rv != 10 || fpd.readOffset != TEST_FIFO_SIZE + 8)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read_iter didn't read the pending data (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_iter_nowait_empty()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    struct kiocb iocb = {0};
+    struct iov_iter iter = {0};
+    iocb.ki_filp = &file;
+    iocb.ki_flags = IOCB_NOWAIT;
+
+    iov_iter_count_ExpectAndReturn(&iter, 20, cmp_pointer);
+    mutex_trylock_ExpectAndReturn(&fpd.read_mutex, 1, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read_iter(&iocb, &iter);
+    if(rv != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read_iter didn't return -EAGAIN (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_read_double_read()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+
+    char firstBufToReturn[] = "simple char";
+    char secondBufToReturn[] = "and another one";
+    ssize_t firstBufLen = strlen(firstBufToReturn) + 1;
+    ssize_t secondBufLen = strlen(secondBufToReturn) + 1;
+    ssize_t fifoSize = firstBufLen + secondBufLen;
+    snprintf((char*)fpd.ring->data, TEST_FIFO_SIZE, "%s%c%s", firstBufToReturn, '\0', secondBufToReturn);
+    set_pending(&fpd, 0, fifoSize);
+    char buf = '\0';
+    loff_t offset;
+    size_t expectedReadOffset = fpd.ring->writeOffset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(&buf, firstBufToReturn, firstBufLen, 0, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(&buf, secondBufToReturn, secondBufLen, 0, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, &buf, firstBufLen, &offset);
+    if(rv != firstBufLen)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len on call 1 (%zd)", firstBufLen);
+    }
+    rv = simple_fifo_read(&file, &buf, secondBufLen, &offset);
+    if(rv != secondBufLen)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len on call 2(%zd)", secondBufLen);
+    }
+    check_result(&fpd, 0, expectedReadOffset, fifoSize, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_read_empty_fifo()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_flags |= O_NONBLOCK;
+
+    char buf = '\0';
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, &buf, 42, &offset);
+    if(rv != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return -EAGAIN (%zd)", rv);
+    }
+    check_result(&fpd, 0, 0, 0, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_read_wrap_read()
+{
+    char dataBuf[TEST_FIFO_SIZE] = {0};
+    dataBuf[60] = 's';
+    dataBuf[61] = 'i';
+    dataBuf[62] = 'm';
+    dataBuf[63] = 'p';
+    dataBuf[ 0] = 'l';
+    dataBuf[ 1] = 'e';
+    dataBuf[ 2] = ' ';
+    dataBuf[ 3] = 'c';
+    dataBuf[ 4] = 'h';
+    dataBuf[ 5] = 'a';
+    dataBuf[ 6] = 'r';
+    dataBuf[ 7] = '\0';
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+
+    memcpy(fpd.ring->data, dataBuf, TEST_FIFO_SIZE);
+    set_pending(&fpd, 60, 12);
+
+    char bufToExpect[] = "simple char";
+
+    char buf = '\0';
+    ssize_t len = strlen(bufToExpect)+1;
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(&buf, &fpd.ring->data[60], 4, 0, cmp_pointer, cmp_pointer, cmp_long);
+    copy_to_user_ExpectAndReturn((char*)&buf + 4, fpd.ring->data, len - 4, 0, cmp_pointer, cmp_pointer, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, &buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len (%zd != %zd)", rv, len);
+    }
+    check_result(&fpd, 0, TEST_FIFO_SIZE + 8, TEST_FIFO_SIZE + 8, dataBuf);
+    return 0;
+}
+
+int test_simple_fifo_read_request_too_big()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+
+    char bufToReturn[] = "simple char";
+    ssize_t len = strlen(bufToReturn) + 1;
+    snprintf((char*)fpd.ring->data, TEST_FIFO_SIZE, "%s", bufToReturn);
+    set_pending(&fpd, 0, len);
+
+    char buf = '\0';
+    loff_t offset;
+    size_t expectedReadOffset = fpd.ring->writeOffset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(&buf, bufToReturn, len, 0, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, &buf, 30, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len (%zd)", len);
+    }
+    check_result(&fpd, 0, expectedReadOffset, len, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_read_copy_to_user_fails()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    char bufToReturn[] = "simple char";
+    ssize_t len = strlen(bufToReturn) + 1;
+    snprintf((char*)fpd.ring->data, TEST_FIFO_SIZE, "%s", bufToReturn);
+    set_pending(&fpd, 0, len);
+
+    char buf = '\0';
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(&buf, bufToReturn, len, 1, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    expect_fault_in_writeable(&buf, len, len);
+
+    ssize_t rv = simple_fifo_read(&file, &buf, len, &offset);
+    if(rv != -EFAULT)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return -EFAULT. It returned %ld", rv);
+    }
+    check_result(&fpd, len, 0, len, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_read_fault_in_retry()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    char bufToReturn[] = "simple char";
+    ssize_t len = strlen(bufToReturn) + 1;
+    snprintf((char*)fpd.ring->data, TEST_FIFO_SIZE, "%s", bufToReturn);
+    set_pending(&fpd, 0, len);
+
+    char buf[TEST_FIFO_SIZE];
+    loff_t offset;
+
+    // The user pages are faulted in without read_mutex, then the read is retried
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(buf, bufToReturn, len, len, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    expect_fault_in_writeable(buf, len, 0);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(buf, bufToReturn, len, 0, cmp_pointer, cmp_str, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, buf, len, &offset);
+    if(rv != len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return len (%zd)", rv);
+    }
+    check_result(&fpd, 0, len, len, fpd.ring->data);
+    return 0;
+}
+
+int test_simple_fifo_read_detached()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    set_pending(&fpd, 0, 42);
+    fpd.detached = true;
+    char buf = '\0';
+    loff_t offset;
+
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_read(&file, &buf, 42, &offset);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return end of file (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_get_size()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    __u64 userSize = 0;
+
+    copy_to_user_ExpectAndReturn(&userSize, NULL, sizeof(userSize), 0, cmp_pointer, NULL, cmp_long);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_GET_SIZE, (unsigned long)&userSize);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_size()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+
+    // Pending data wraps around the end of the current ring
+    fpd.ring->data[TEST_FIFO_SIZE - 2] = 'a';
+    fpd.ring->data[TEST_FIFO_SIZE - 1] = 'b';
+    fpd.ring->data[0] = 'c';
+    set_pending(&fpd, TEST_FIFO_SIZE - 2, 3);
+    uint8_t* oldRing = fpd.ring->data;
+    __u64 requestedSize = SIMPLE_FIFO_MIN_SIZE;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedSize, sizeof(requestedSize), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedSize, sizeof(requestedSize));
+    __roundup_pow_of_two_ExpectAndReturn(SIMPLE_FIFO_MIN_SIZE, SIMPLE_FIFO_MIN_SIZE, cmp_u_long);
+    vmalloc_user_ExpectAndReturn(PAGE_SIZE + SIMPLE_FIFO_MIN_SIZE, test_resized_ring, cmp_u_long);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    expect_wake_up_writers(&dev_data);
+    kvfree_ExpectAndReturn(oldRing, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_SIZE, (unsigned long)&requestedSize);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    if(fpd.ring->data != test_resized_ring + PAGE_SIZE || fpd.ring->capacity != SIMPLE_FIFO_MIN_SIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't install the new ring");
+    }
+    if(fpd.readOffset != 0 || fpd.ring->writeOffset != 3)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't move the pending data to the beginning of the ring");
+    }
+    if(memcmp(test_resized_ring + PAGE_SIZE, "abc", 3) != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't copy the pending data");
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_size_invalid()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    __u64 requestedSize = SIMPLE_FIFO_MAX_SIZE + 1;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedSize, sizeof(requestedSize), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedSize, sizeof(requestedSize));
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_SIZE, (unsigned long)&requestedSize);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EINVAL (%ld)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_size_broadcast()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    __u64 requestedSize = SIMPLE_FIFO_MIN_SIZE;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedSize, sizeof(requestedSize), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedSize, sizeof(requestedSize));
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_SIZE, (unsigned long)&requestedSize);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EINVAL (%ld)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_size_busy()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    set_pending(&fpd, 0, SIMPLE_FIFO_MIN_SIZE + 1);
+    __u64 requestedSize = SIMPLE_FIFO_MIN_SIZE;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedSize, sizeof(requestedSize), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedSize, sizeof(requestedSize));
+    __roundup_pow_of_two_ExpectAndReturn(SIMPLE_FIFO_MIN_SIZE, SIMPLE_FIFO_MIN_SIZE, cmp_u_long);
+    vmalloc_user_ExpectAndReturn(PAGE_SIZE + SIMPLE_FIFO_MIN_SIZE, test_resized_ring, cmp_u_long);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    vfree_ExpectAndReturn(test_resized_ring, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_SIZE, (unsigned long)&requestedSize);
+    if(rv != -EBUSY)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EBUSY (%ld)", rv);
+    }
+    if(fpd.ring->data != test_rings[0])
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl replaced the ring");
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_get_policy()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.policy = SIMPLE_FIFO_POLICY_DETACH;
+    __u32 userPolicy = 0;
+
+    copy_to_user_ExpectAndReturn(&userPolicy, NULL, sizeof(userPolicy), 0, cmp_pointer, NULL, cmp_long);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_GET_POLICY, (unsigned long)&userPolicy);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_policy()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    __u32 requestedPolicy = SIMPLE_FIFO_POLICY_DROP_OLDEST;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedPolicy, sizeof(requestedPolicy), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedPolicy, sizeof(requestedPolicy));
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    expect_wake_up_writers(&dev_data);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_POLICY, (unsigned long)&requestedPolicy);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    if(fpd.policy != SIMPLE_FIFO_POLICY_DROP_OLDEST)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't set the policy (%u)", fpd.policy);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_policy_broadcast_drop_newest()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    __u32 requestedPolicy = SIMPLE_FIFO_POLICY_DROP_NEWEST;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedPolicy, sizeof(requestedPolicy), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedPolicy, sizeof(requestedPolicy));
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_POLICY, (unsigned long)&requestedPolicy);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EINVAL (%ld)", rv);
+    }
+    if(fpd[0].policy != SIMPLE_FIFO_POLICY_BLOCK)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl changed the policy (%u)", fpd[0].policy);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_size_mapped()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.mapped = true;
+    __u64 requestedSize = SIMPLE_FIFO_MIN_SIZE;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedSize, sizeof(requestedSize), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedSize, sizeof(requestedSize));
+    __roundup_pow_of_two_ExpectAndReturn(SIMPLE_FIFO_MIN_SIZE, SIMPLE_FIFO_MIN_SIZE, cmp_u_long);
+    vmalloc_user_ExpectAndReturn(PAGE_SIZE + SIMPLE_FIFO_MIN_SIZE, test_resized_ring, cmp_u_long);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    vfree_ExpectAndReturn(test_resized_ring, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_SIZE, (unsigned long)&requestedSize);
+    if(rv != -EBUSY)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EBUSY (%ld)", rv);
+    }
+    if(fpd.ring->data != test_rings[0])
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl replaced the mapped ring");
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_set_policy_mapped()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.mapped = true;
+    __u32 requestedPolicy = SIMPLE_FIFO_POLICY_DROP_OLDEST;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &requestedPolicy, sizeof(requestedPolicy), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &requestedPolicy, sizeof(requestedPolicy));
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_SET_POLICY, (unsigned long)&requestedPolicy);
+    if(rv != -EBUSY)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EBUSY (%ld)", rv);
+    }
+    if(fpd.policy != SIMPLE_FIFO_POLICY_BLOCK)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl changed the policy (%u)", fpd.policy);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_consume()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    set_pending(&fpd, 0, 10);
+    __u64 count = 4;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &count, sizeof(count), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &count, sizeof(count));
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    expect_wake_up_writers(&dev_data);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_CONSUME, (unsigned long)&count);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    if(fpd.readOffset != 4)
+    {
+        easyMock_addError(easyMock_true, "readOffset hasn't been moved (%zu != 4)", fpd.readOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_consume_too_much()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    set_pending(&fpd, 0, 10);
+    __u64 count = 11;
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &count, sizeof(count), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &count, sizeof(count));
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_CONSUME, (unsigned long)&count);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EINVAL (%ld)", rv);
+    }
+    if(fpd.readOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "readOffset has been moved (%zu)", fpd.readOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_consume_inside_record()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    dev_data.recordMode = true;
+    size_t secondRecord = put_record(&fpd, 0, "hello");
+    fpd.ring->writeOffset = put_record(&fpd, secondRecord, "abc");
+    __u64 count = secondRecord + 1;
+
+    // The count ends in the middle of the second record
+    copy_from_user_ExpectReturnAndOutput(NULL, &count, sizeof(count), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &count, sizeof(count));
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_CONSUME, (unsigned long)&count);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EINVAL (%ld)", rv);
+    }
+    if(fpd.readOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "readOffset has been moved (%zu)", fpd.readOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_commit()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.staging = test_rings[1];
+    fpd.stagingSize = TEST_FIFO_SIZE;
+    struct simple_fifo_commit commit = {.offset = 8, .len = 20};
+
+    // The range is published from the staging area like a write of it
+    copy_from_user_ExpectReturnAndOutput(NULL, &commit, sizeof(commit), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &commit, sizeof(commit));
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,1,0)
+    iov_iter_kvec_ExpectAndReturn(NULL, ITER_SOURCE, NULL, 1, commit.len, cmp_not_null_pointer, cmp_u_int, cmp_not_null_pointer, cmp_u_long, cmp_u_long);
+#else
+    iov_iter_kvec_ExpectAndReturn(NULL, WRITE, NULL, 1, commit.len, cmp_not_null_pointer, cmp_u_int, cmp_not_null_pointer, cmp_u_long, cmp_u_long);
+#endif
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    pagefault_disable_ExpectAndReturn();
+    copy_from_iter_ExpectAndReturn(fpd.ring->data, commit.len, NULL, commit.len, cmp_pointer, cmp_u_long, cmp_not_null_pointer);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_readers(fpd.ring);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_COMMIT, (unsigned long)&commit);
+    if(rv != (long)commit.len || fpd.ring->writeOffset != commit.len)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't publish the range (%ld)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_commit_out_of_range()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.staging = test_rings[1];
+    fpd.stagingSize = TEST_FIFO_SIZE;
+    struct simple_fifo_commit commit = {.offset = TEST_FIFO_SIZE - 4, .len = 8};
+
+    copy_from_user_ExpectReturnAndOutput(NULL, &commit, sizeof(commit), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, &commit, sizeof(commit));
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_COMMIT, (unsigned long)&commit);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EINVAL (%ld)", rv);
+    }
+    return 0;
+}
+
+/*
+ * A shared mapping of the ring of a file opened for reading, which could be made writable with mprotect().
+ */
+static void prepare_ring_vma(struct vm_area_struct* vma, struct mm_struct* mm, vm_flags_t flags)
+{
+    vma->vm_mm = mm;
+    vma->vm_start = 0x10000;
+    vma->vm_end = vma->vm_start + PAGE_SIZE + TEST_FIFO_SIZE;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+    vm_flags_init(vma, flags);
+#else
+    vma->vm_flags = flags;
+#endif
+}
+
+int test_simple_fifo_mmap()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    struct vm_area_struct vma = {0};
+    struct mm_struct mm = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.privateRing.ctrl = (struct simple_fifo_mmap_ctrl*)test_mappable_ring;
+    prepare_ring_vma(&vma, &mm, VM_READ | VM_SHARED | VM_MAYREAD | VM_MAYWRITE | VM_MAYSHARE);
+
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    remap_vmalloc_range_ExpectAndReturn(&vma, test_mappable_ring, 0, 0, cmp_pointer, cmp_pointer, cmp_u_long);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+
+    int rv = simple_fifo_mmap(&file, &vma);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_mmap didn't return 0 (%d)", rv);
+    }
+    if(!fpd.mapped)
+    {
+        easyMock_addError(easyMock_true, "the file hasn't been marked as mapped");
+    }
+    if(vma.vm_flags & VM_MAYWRITE)
+    {
+        easyMock_addError(easyMock_true, "the mapping can still be made writable");
+    }
+    return 0;
+}
+
+int test_simple_fifo_mmap_writable()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    struct vm_area_struct vma = {0};
+    struct mm_struct mm = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.privateRing.ctrl = (struct simple_fifo_mmap_ctrl*)test_mappable_ring;
+    prepare_ring_vma(&vma, &mm, VM_READ | VM_WRITE | VM_SHARED | VM_MAYREAD | VM_MAYWRITE | VM_MAYSHARE);
+
+    int rv = simple_fifo_mmap(&file, &vma);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_mmap didn't return -EINVAL (%d)", rv);
+    }
+    if(fpd.mapped)
+    {
+        easyMock_addError(easyMock_true, "the file has been marked as mapped");
+    }
+    return 0;
+}
+
+int test_simple_fifo_mmap_drop_oldest()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    struct vm_area_struct vma = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    fpd.privateRing.ctrl = (struct simple_fifo_mmap_ctrl*)test_mappable_ring;
+    fpd.policy = SIMPLE_FIFO_POLICY_DROP_OLDEST;
+    vma.vm_start = 0x10000;
+    vma.vm_end = vma.vm_start + PAGE_SIZE + TEST_FIFO_SIZE;
+
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+
+    int rv = simple_fifo_mmap(&file, &vma);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_mmap didn't return -EINVAL (%d)", rv);
+    }
+    if(fpd.mapped)
+    {
+        easyMock_addError(easyMock_true, "the file has been marked as mapped");
+    }
+    return 0;
+}
+
+static void prepare_staging_vma(struct vm_area_struct* vma, size_t size)
+{
+    vma->vm_start = 0x10000;
+    vma->vm_end = vma->vm_start + size;
+    vma->vm_pgoff = SIMPLE_FIFO_MMAP_STAGING_OFFSET >> PAGE_SHIFT;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,3,0)
+    vm_flags_init(vma, VM_SHARED | VM_WRITE);
+#else
+    vma->vm_flags = VM_SHARED | VM_WRITE;
+#endif
+}
+
+int test_simple_fifo_mmap_staging()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    struct vm_area_struct vma = {0};
+    fpd.parent = &dev_data;
+    file.f_flags = O_WRONLY;
+    file.f_mode = FMODE_WRITE;
+    file.private_data = (void*)&fpd;
+    prepare_staging_vma(&vma, TEST_FIFO_SIZE);
+
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    vmalloc_user_ExpectAndReturn(TEST_FIFO_SIZE, test_rings[1], cmp_u_long);
+    remap_vmalloc_range_ExpectAndReturn(&vma, test_rings[1], 0, 0, cmp_pointer, cmp_pointer, cmp_u_long);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+
+    int rv = simple_fifo_mmap(&file, &vma);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_mmap didn't return 0 (%d)", rv);
+    }
+    if(fpd.staging != test_rings[1] || fpd.stagingSize != TEST_FIFO_SIZE)
+    {
+        easyMock_addError(easyMock_true, "the staging area hasn't been set (%p, %zu)", fpd.staging, fpd.stagingSize);
+    }
+    return 0;
+}
+
+int test_simple_fifo_mmap_staging_twice()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    struct vm_area_struct vma = {0};
+    fpd.parent = &dev_data;
+    fpd.staging = test_rings[1];
+    fpd.stagingSize = TEST_FIFO_SIZE;
+    file.f_flags = O_WRONLY;
+    file.f_mode = FMODE_WRITE;
+    file.private_data = (void*)&fpd;
+    prepare_staging_vma(&vma, TEST_FIFO_SIZE);
+
+    mutex_lock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.map_mutex, cmp_pointer);
+
+    int rv = simple_fifo_mmap(&file, &vma);
+    if(rv != -EBUSY)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_mmap didn't return -EBUSY (%d)", rv);
+    }
+    return 0;
+}
+
+static void expect_copy_channel_name(struct simple_fifo_channel_name* channelName)
+{
+    copy_from_user_ExpectReturnAndOutput(NULL, channelName, sizeof(*channelName), 0, cmp_not_null_pointer, cmp_pointer, cmp_long, channelName, sizeof(*channelName));
+}
+
+int test_simple_fifo_ioctl_bind_channel()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    struct simple_fifo_channel channel = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    struct simple_fifo_channel_name channelName = {"news"};
+    struct hlist_head* bucket = &dev_data.channels[hash_min(jhash("news", 4, 0), SIMPLE_FIFO_CHANNEL_HASH_BITS)];
+
+    expect_copy_channel_name(&channelName);
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    // The channel doesn't exist yet
+    kzalloc_ExpectAndReturn(sizeof(struct simple_fifo_channel), GFP_KERNEL, &channel, cmp_u_long, cmp_int);
+    INIT_LIST_HEAD_ExpectAndReturn(&channel.opened_file_list, cmp_pointer);
+    hlist_add_head_ExpectAndReturn(&channel.node, bucket, cmp_pointer, cmp_pointer);
+    list_del_rcu_ExpectAndReturn(&fpd.file_entry, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    // The file is only added to the channel once no writer can walk over it anymore
+    synchronize_rcu_ExpectAndReturn();
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    list_add_rcu_ExpectAndReturn(&fpd.file_entry, &channel.opened_file_list, cmp_pointer, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    expect_wake_up_writers(&dev_data);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_BIND_CHANNEL, (unsigned long)&channelName);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    if(fpd.channel != &channel || channel.refCount != 1 || strcmp(channel.name, "news") != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't bind the file to a new channel");
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_bind_existing_channel()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct simple_fifo_channel channel = {0};
+    prepare_channel(&dev_data, &channel, "news", 1);
+    struct simple_fifo_channel_name channelName = {"news"};
+
+    // A write only file is not in any list, only the channel is looked up
+    struct file_private_data fpd = {0};
+    fpd.parent = &dev_data;
+    struct file file = {0};
+    file.f_flags = O_WRONLY;
+    file.private_data = &fpd;
+
+    expect_copy_channel_name(&channelName);
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_BIND_CHANNEL, (unsigned long)&channelName);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    if(fpd.channel != &channel || channel.refCount != 2)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't bind the file to the existing channel (refCount %u)", channel.refCount);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_bind_channel_twice()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    struct simple_fifo_channel channel = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    prepare_channel(&dev_data, &channel, "news", 1);
+    fpd.channel = &channel;
+    struct simple_fifo_channel_name channelName = {"sports"};
+
+    expect_copy_channel_name(&channelName);
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_BIND_CHANNEL, (unsigned long)&channelName);
+    if(rv != -EBUSY || fpd.channel != &channel)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EBUSY (%ld)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_bind_channel_invalid_name()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    struct simple_fifo_channel_name channelName;
+    // Not NUL terminated
+    memset(channelName.name, 'a', sizeof(channelName.name));
+
+    expect_copy_channel_name(&channelName);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_BIND_CHANNEL, (unsigned long)&channelName);
+    if(rv != -EINVAL || fpd.channel != NULL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return -EINVAL (%ld)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_bind_channel_broadcast()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    struct simple_fifo_channel channel = {0};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    dev_data.capacity = TEST_FIFO_SIZE;
+    dev_data.sharedRing.writeOffset = 10;
+    fpd[0].readOffset = 4;
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    struct simple_fifo_channel_name channelName = {"news"};
+    struct hlist_head* bucket = &dev_data.channels[hash_min(jhash("news", 4, 0), SIMPLE_FIFO_CHANNEL_HASH_BITS)];
+
+    // A new channel of a broadcast fifo gets its own shared ring. Neither the writers nor a read of the file run until
+    // the file has moved to it
+    expect_copy_channel_name(&channelName);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    kzalloc_ExpectAndReturn(sizeof(struct simple_fifo_channel), GFP_KERNEL, &channel, cmp_u_long, cmp_int);
+    kvmalloc_ExpectAndReturn(TEST_FIFO_SIZE, GFP_KERNEL, test_rings[1], cmp_u_long, cmp_int);
+    __init_waitqueue_head_ExpectAndReturn(&channel.ring.readWait, "&ring->readWait", NULL, cmp_pointer, cmp_str, NULL);
+    INIT_LIST_HEAD_ExpectAndReturn(&channel.opened_file_list, cmp_pointer);
+    hlist_add_head_ExpectAndReturn(&channel.node, bucket, cmp_pointer, cmp_pointer);
+    list_del_rcu_ExpectAndReturn(&fpd[0].file_entry, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    synchronize_rcu_ExpectAndReturn();
+    // The file moves to the ring of the channel, its pending data in the ring of the device is dropped
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    list_add_rcu_ExpectAndReturn(&fpd[0].file_entry, &channel.opened_file_list, cmp_pointer, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    expect_wake_up_writers(&dev_data);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_BIND_CHANNEL, (unsigned long)&channelName);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    if(fpd[0].channel != &channel || fpd[0].ring != &channel.ring || channel.ring.data != test_rings[1])
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't move the file to the ring of the channel");
+    }
+    if(fpd[0].readOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "the read offset hasn't been reset (%zu)", fpd[0].readOffset);
+    }
+    return 0;
+}
+
+int test_simple_fifo_ioctl_bind_channel_broadcast_write()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    struct simple_fifo_channel channel = {0};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    prepare_channel(&dev_data, &channel, "news", 1);
+    channel.ring.data = test_rings[1];
+    channel.ring.capacity = TEST_FIFO_SIZE;
+    dev_data.sharedRing.writeOffset = 10;
+    fpd[0].readOffset = 4;
+    fpd[1].readOffset = 10;
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    file.f_flags |= O_NONBLOCK;
+    struct file writerFile = {0};
+    writerFile.private_data = &fpd[1];
+    struct simple_fifo_channel_name channelName = {"news"};
+    char buf[TEST_FIFO_SIZE] = "simple char";
+    loff_t offset;
+
+    // The first file, with data pending in the ring of the device, moves to the channel
+    expect_copy_channel_name(&channelName);
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    list_del_rcu_ExpectAndReturn(&fpd[0].file_entry, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    synchronize_rcu_ExpectAndReturn();
+    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    list_add_rcu_ExpectAndReturn(&fpd[0].file_entry, &channel.opened_file_list, cmp_pointer, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    expect_wake_up_writers(&dev_data);
+
+    long rv = simple_fifo_ioctl(&file, SIMPLE_FIFO_IOC_BIND_CHANNEL, (unsigned long)&channelName);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_ioctl didn't return 0 (%ld)", rv);
+    }
+    fpd[0].file_entry.prev->next = fpd[0].file_entry.next;
+    fpd[0].file_entry.next->prev = fpd[0].file_entry.prev;
+    test_list_add_tail(&fpd[0].file_entry, &channel.opened_file_list);
+
+    // A write to the device, which the bind held back, no longer waits for the moved file and wraps over its old
+    // read offset
+    mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    expect_copy_from_user(&dev_data.sharedRing, dev_data.sharedRing.writeOffset, buf, TEST_FIFO_SIZE);
+    expect_wake_up_readers(&dev_data.sharedRing);
+    rcu_read_unlock_ExpectAndReturn();
+    mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+
+    ssize_t written = simple_fifo_write(&writerFile, buf, TEST_FIFO_SIZE, &offset);
+    if(written != TEST_FIFO_SIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_write didn't return %d (%zd)", TEST_FIFO_SIZE, written);
+    }
+
+    // The moved file only reads the ring of the channel, which is empty
+    mutex_lock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd[0].read_mutex, cmp_pointer);
+
+    ssize_t readLen = simple_fifo_read(&file, buf, sizeof(buf), &offset);
+    if(readLen != -EAGAIN)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_read didn't return -EAGAIN (%zd)", readLen);
+    }
+    if(fpd[0].ring != &channel.ring || fpd[0].readOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "the file still reads the ring of the device (%zu)", fpd[0].readOffset);
+    }
+    return 0;
+}
+
+static void expect_poll(struct simpleFifo_device_data* dev_data, struct file* file, struct file_private_data* fpd, poll_table* wait)
+{
+    poll_wait_ExpectAndReturn(file, &fpd->ring->readWait, wait, cmp_pointer, cmp_pointer, cmp_pointer);
+    poll_wait_ExpectAndReturn(file, &dev_data->writeWait, wait, cmp_pointer, cmp_pointer, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+}
+
+int test_simple_fifo_poll_empty()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    poll_table wait;
+
+    expect_poll(&dev_data, &file, &fpd, &wait);
+    rcu_read_unlock_ExpectAndReturn();
+
+    __poll_t rv = simple_fifo_poll(&file, &wait);
+    if(rv != (EPOLLOUT | EPOLLWRNORM))
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_poll didn't return EPOLLOUT only (0x%x)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_poll_data_pending()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    poll_table wait;
+
+    set_pending(&fpd, 0, 4);
+
+    expect_poll(&dev_data, &file, &fpd, &wait);
+    rcu_read_unlock_ExpectAndReturn();
+
+    __poll_t rv = simple_fifo_poll(&file, &wait);
+    if(rv != (EPOLLIN | EPOLLRDNORM | EPOLLOUT | EPOLLWRNORM))
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_poll didn't return EPOLLIN and EPOLLOUT (0x%x)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_poll_other_reader_full()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_write_two_file(&dev_data, fpd);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    poll_table wait;
+
+    // The second reader is full so nothing can be written
+    set_pending(&fpd[1], 0, TEST_FIFO_SIZE);
+
+    expect_poll(&dev_data, &file, &fpd[0], &wait);
+    rcu_read_unlock_ExpectAndReturn();
+
+    __poll_t rv = simple_fifo_poll(&file, &wait);
+    if(rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_poll didn't return 0 (0x%x)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_poll_detached()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    set_pending(&fpd, 0, TEST_FIFO_SIZE);
+    fpd.detached = true;
+    poll_table wait;
+
+    expect_poll(&dev_data, &file, &fpd, &wait);
+    rcu_read_unlock_ExpectAndReturn();
+
+    // A detached file doesn't block the writers anymore
+    __poll_t rv = simple_fifo_poll(&file, &wait);
+    if(rv != (EPOLLHUP | EPOLLOUT | EPOLLWRNORM))
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_poll didn't return EPOLLHUP and EPOLLOUT (0x%x)", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_poll_write_only()
+{
+    struct simpleFifo_device_data dev_data = {0};
+    struct file readerFile = {0};
+    struct file_private_data readerFpd = {0};
+    prepare_one_file(&dev_data, &readerFile, &readerFpd);
+    set_pending(&readerFpd, 0, 42);
+
+    struct file_private_data writerFpd = {0};
+    writerFpd.parent = &dev_data;
+    struct file file = {0};
+    file.f_flags = O_WRONLY;
+    file.private_data = &writerFpd;
+    poll_table wait;
+
+    poll_wait_ExpectAndReturn(&file, &dev_data.writeWait, &wait, cmp_pointer, cmp_pointer, cmp_pointer);
+    rcu_read_lock_ExpectAndReturn();
+    rcu_read_unlock_ExpectAndReturn();
+
+    __poll_t rv = simple_fifo_poll(&file, &wait);
+    if(rv != (EPOLLOUT | EPOLLWRNORM))
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_poll didn't return EPOLLOUT only (0x%x)", rv);
+    }
+    return 0;
+}
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+static void prepare_uring_cmd(struct io_uring_cmd* ioucmd, struct io_uring_sqe* sqe, struct file* file, __u32 op,
+                              struct simple_fifo_uring_cmd const* cmd)
+{
+    ioucmd->file = file;
+    ioucmd->cmd_op = op;
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,5,0)
+    memcpy((void*)io_uring_sqe_cmd(sqe), cmd, sizeof(*cmd));
+    ioucmd->sqe = sqe;
+#else
+    ioucmd->cmd = cmd;
+#endif
+}
+
+static void expect_copy_msg(struct simple_fifo_msg* msg)
+{
+    copy_from_user_ExpectReturnAndOutput(NULL, msg, sizeof(*msg), 0, NULL, cmp_pointer, cmp_long, msg, sizeof(*msg));
+}
+#endif
+
+int test_simple_fifo_uring_cmd_publish()
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_mode = FMODE_WRITE;
+    char first[] = "first";
+    char second[] = "second";
+    struct simple_fifo_msg msgs[2] = {{(__u64)(uintptr_t)first, 5, 0}, {(__u64)(uintptr_t)second, 6, 0}};
+    struct simple_fifo_uring_cmd cmd = {(__u64)(uintptr_t)msgs, 2, 0};
+    struct io_uring_cmd ioucmd = {0};
+    struct io_uring_sqe sqe = {0};
+    prepare_uring_cmd(&ioucmd, &sqe, &file, SIMPLE_FIFO_URING_CMD_PUBLISH, &cmd);
+
+    // Each message is written like a write() of its own
+    for(unsigned int idx = 0; idx < 2; ++idx)
+    {
+        expect_copy_msg(&msgs[idx]);
+        mutex_lock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+        rcu_read_lock_ExpectAndReturn();
+        expect_fan_out(&fpd, 1, NULL, (char*)(uintptr_t)msgs[idx].addr, msgs[idx].len, idx * 5);
+        rcu_read_unlock_ExpectAndReturn();
+        mutex_unlock_ExpectAndReturn(&dev_data.write_mutex, cmp_pointer);
+    }
+
+    int rv = simple_fifo_uring_cmd(&ioucmd, 0);
+    if(rv != 2)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_uring_cmd didn't publish the messages (%d)", rv);
+    }
+    char dataToExpect[TEST_FIFO_SIZE] = "firstsecond";
+    check_result(&fpd, 11, 0, 11, dataToExpect);
+#endif
+    return 0;
+}
+
+int test_simple_fifo_uring_cmd_publish_too_big()
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_mode = FMODE_WRITE;
+    struct simple_fifo_msg msg = {0, SIMPLE_FIFO_ATOMIC_SIZE + 1, 0};
+    struct simple_fifo_uring_cmd cmd = {(__u64)(uintptr_t)&msg, 1, 0};
+    struct io_uring_cmd ioucmd = {0};
+    struct io_uring_sqe sqe = {0};
+    prepare_uring_cmd(&ioucmd, &sqe, &file, SIMPLE_FIFO_URING_CMD_PUBLISH, &cmd);
+
+    // A message of a byte stream is never split
+    expect_copy_msg(&msg);
+
+    int rv = simple_fifo_uring_cmd(&ioucmd, 0);
+    if(rv != -EMSGSIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_uring_cmd didn't return -EMSGSIZE (%d)", rv);
+    }
+#endif
+    return 0;
+}
 
-    char buf = '\0';
-    loff_t offset;
+int test_simple_fifo_uring_cmd_publish_read_only()
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_mode = FMODE_READ;
+    char first[] = "first";
+    struct simple_fifo_msg msg = {(__u64)(uintptr_t)first, 5, 0};
+    struct simple_fifo_uring_cmd cmd = {(__u64)(uintptr_t)&msg, 1, 0};
+    struct io_uring_cmd ioucmd = {0};
+    struct io_uring_sqe sqe = {0};
+    prepare_uring_cmd(&ioucmd, &sqe, &file, SIMPLE_FIFO_URING_CMD_PUBLISH, &cmd);
+
+    // Nothing is read from the user nor written through a file opened read only
+    int rv = simple_fifo_uring_cmd(&ioucmd, 0);
+    if(rv != -EBADF || fpd.ring->writeOffset != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_uring_cmd didn't return -EBADF (%d)", rv);
+    }
+#endif
+    return 0;
+}
 
-    mutex_lock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
-    copy_to_user_ExpectAndReturn(&buf, bufToReturn, len, 1, cmp_pointer, cmp_str, cmp_long);
-    mutex_unlock_ExpectAndReturn(&dev_data.open_file_list_mutex, cmp_pointer);
+int test_simple_fifo_uring_cmd_consume()
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_mode = FMODE_READ;
+    set_pending(&fpd, 0, 10);
+    char bufs[2][16];
+    struct simple_fifo_msg msgs[2] = {{(__u64)(uintptr_t)bufs[0], 16, 0}, {(__u64)(uintptr_t)bufs[1], 16, 0}};
+    struct simple_fifo_uring_cmd cmd = {(__u64)(uintptr_t)msgs, 2, 0};
+    struct io_uring_cmd ioucmd = {0};
+    struct io_uring_sqe sqe = {0};
+    prepare_uring_cmd(&ioucmd, &sqe, &file, SIMPLE_FIFO_URING_CMD_CONSUME, &cmd);
+
+    expect_copy_msg(&msgs[0]);
+    mutex_lock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    pagefault_disable_ExpectAndReturn();
+    copy_to_user_ExpectAndReturn(bufs[0], fpd.ring->data, 10, 0, cmp_pointer, cmp_pointer, cmp_long);
+    pagefault_enable_ExpectAndReturn();
+    expect_wake_up_writers(&dev_data);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+    copy_to_user_ExpectAndReturn(&msgs[0].len, NULL, sizeof(msgs[0].len), 0, cmp_pointer, NULL, cmp_long);
+    // The batch ends once the pending data has been read
+    expect_copy_msg(&msgs[1]);
+    mutex_trylock_ExpectAndReturn(&fpd.read_mutex, 1, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&fpd.read_mutex, cmp_pointer);
+
+    int rv = simple_fifo_uring_cmd(&ioucmd, 0);
+    if(rv != 1 || fpd.readOffset != 10)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_uring_cmd didn't consume one message (%d)", rv);
+    }
+#endif
+    return 0;
+}
 
-    ssize_t rv = simple_fifo_read(&file, &buf, len, &offset);
-    if(rv != -EFAULT)
+int test_simple_fifo_uring_cmd_occupancy()
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_mode = FMODE_READ;
+    set_pending(&fpd, 3, 10);
+    struct simple_fifo_uring_cmd cmd = {0};
+    struct io_uring_cmd ioucmd = {0};
+    struct io_uring_sqe sqe = {0};
+    prepare_uring_cmd(&ioucmd, &sqe, &file, SIMPLE_FIFO_URING_CMD_OCCUPANCY, &cmd);
+
+    int rv = simple_fifo_uring_cmd(&ioucmd, IO_URING_F_NONBLOCK);
+    if(rv != 10)
     {
-        easyMock_addError(easyMock_true, "simple_fifo_read didn't return -EFAULT. It returned %ld", rv);
+        easyMock_addError(easyMock_true, "simple_fifo_uring_cmd didn't return the pending data (%d)", rv);
+    }
+#endif
+    return 0;
+}
+
+int test_simple_fifo_uring_cmd_occupancy_overtaken()
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+    struct simpleFifo_device_data dev_data = {0};
+    struct file_private_data fpd[2] = {{0}, {0}};
+    prepare_broadcast_two_file(&dev_data, fpd);
+    struct file file = {0};
+    file.private_data = &fpd[0];
+    file.f_mode = FMODE_READ;
+    // A detached file overtaken by the writers of the shared ring
+    fpd[0].detached = true;
+    dev_data.sharedRing.writeOffset = (size_t)INT_MAX + 1;
+    struct simple_fifo_uring_cmd cmd = {0};
+    struct io_uring_cmd ioucmd = {0};
+    struct io_uring_sqe sqe = {0};
+    prepare_uring_cmd(&ioucmd, &sqe, &file, SIMPLE_FIFO_URING_CMD_OCCUPANCY, &cmd);
+
+    int rv = simple_fifo_uring_cmd(&ioucmd, IO_URING_F_NONBLOCK);
+    if(rv != TEST_FIFO_SIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_uring_cmd didn't bound the pending data by the capacity (%d)", rv);
+    }
+#endif
+    return 0;
+}
+
+int test_simple_fifo_uring_cmd_invalid_flags()
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5,19,0)
+    struct simpleFifo_device_data dev_data = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+    prepare_one_file(&dev_data, &file, &fpd);
+    file.f_mode = FMODE_WRITE;
+    struct simple_fifo_uring_cmd cmd = {0, 1, 1};
+    struct io_uring_cmd ioucmd = {0};
+    struct io_uring_sqe sqe = {0};
+    prepare_uring_cmd(&ioucmd, &sqe, &file, SIMPLE_FIFO_URING_CMD_PUBLISH, &cmd);
+
+    int rv = simple_fifo_uring_cmd(&ioucmd, 0);
+    if(rv != -EINVAL)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_uring_cmd didn't return -EINVAL (%d)", rv);
     }
-    check_result(&fpd, fpd.size, fpd.readOffset, fpd.writeOffset, &fpd.data);
+#endif
     return 0;
 }
 
@@ -989,16 +3765,94 @@ int test_simple_fifo_release()
     struct file_private_data fpd = {0};
 
     fpd.parent = &parent;
+    prepare_ring(&fpd, test_rings[0]);
 
     parent.dev = (struct device*)0xdeadbeef;
 
     mutex_lock_ExpectAndReturn(&parent.open_file_list_mutex, cmp_pointer);
-    list_del_ExpectAndReturn(&fpd.file_entry, cmp_pointer);
-    devm_kfree_ExpectAndReturn(parent.dev, &fpd, cmp_pointer, cmp_pointer);
+    list_del_rcu_ExpectAndReturn(&fpd.file_entry, cmp_pointer);
     mutex_unlock_ExpectAndReturn(&parent.open_file_list_mutex, cmp_pointer);
+    call_rcu_ExpectAndReturn(&fpd.rcu, simple_fifo_free_rcu, cmp_pointer, cmp_pointer);
+    expect_wake_up_writers(&parent);
+
+    file.private_data = (void*)&fpd;
+
+    int rv = simple_fifo_release(&inode, &file);
+    if (rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_release didn't return 0. %d", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_release_write_only()
+{
+    struct inode inode;
+    struct simpleFifo_device_data parent = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+
+    fpd.parent = &parent;
+    file.f_flags = O_WRONLY;
+    file.private_data = (void*)&fpd;
+
+    // Nothing can reach a write only file, it is freed right away
+    kmem_cache_free_ExpectAndReturn(fpd_cache, &fpd, cmp_pointer, cmp_pointer);
+
+    int rv = simple_fifo_release(&inode, &file);
+    if (rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_release didn't return 0. %d", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_release_staging()
+{
+    struct inode inode;
+    struct simpleFifo_device_data parent = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+
+    fpd.parent = &parent;
+    fpd.staging = test_rings[1];
+    file.f_flags = O_WRONLY;
+    file.private_data = (void*)&fpd;
+
+    vfree_ExpectAndReturn(test_rings[1], cmp_pointer);
+    kmem_cache_free_ExpectAndReturn(fpd_cache, &fpd, cmp_pointer, cmp_pointer);
+
+    int rv = simple_fifo_release(&inode, &file);
+    if (rv != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_release didn't return 0. %d", rv);
+    }
+    return 0;
+}
+
+int test_simple_fifo_release_last_of_channel()
+{
+    struct inode inode;
+    struct simpleFifo_device_data parent = {0};
+    struct simple_fifo_channel channel = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
 
+    fpd.parent = &parent;
+    prepare_ring(&fpd, test_rings[0]);
+    prepare_channel(&parent, &channel, "news", 1);
+    fpd.channel = &channel;
     file.private_data = (void*)&fpd;
 
+    mutex_lock_ExpectAndReturn(&parent.open_file_list_mutex, cmp_pointer);
+    list_del_rcu_ExpectAndReturn(&fpd.file_entry, cmp_pointer);
+    // Nothing can reach the channel anymore
+    hlist_del_init_ExpectAndReturn(&channel.node, cmp_pointer);
+    kfree_ExpectAndReturn(&channel, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&parent.open_file_list_mutex, cmp_pointer);
+    call_rcu_ExpectAndReturn(&fpd.rcu, simple_fifo_free_rcu, cmp_pointer, cmp_pointer);
+    expect_wake_up_writers(&parent);
+
     int rv = simple_fifo_release(&inode, &file);
     if (rv != 0)
     {
@@ -1007,17 +3861,356 @@ int test_simple_fifo_release()
     return 0;
 }
 
+int test_simple_fifo_release_write_only_channel()
+{
+    struct inode inode;
+    struct simpleFifo_device_data parent = {0};
+    struct simple_fifo_channel channel = {0};
+    struct file file = {0};
+    struct file_private_data fpd = {0};
+
+    fpd.parent = &parent;
+    prepare_channel(&parent, &channel, "news", 2);
+    fpd.channel = &channel;
+    file.f_flags = O_WRONLY;
+    file.private_data = (void*)&fpd;
+
+    // Another file is still bound to the channel
+    mutex_lock_ExpectAndReturn(&parent.open_file_list_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&parent.open_file_list_mutex, cmp_pointer);
+    kmem_cache_free_ExpectAndReturn(fpd_cache, &fpd, cmp_pointer, cmp_pointer);
+
+    int rv = simple_fifo_release(&inode, &file);
+    if (rv != 0 || channel.refCount != 1)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_release didn't drop its reference on the channel (%d, %u)", rv, channel.refCount);
+    }
+    return 0;
+}
+
+int test_simple_fifo_free_rcu()
+{
+    struct simpleFifo_device_data parent;
+    struct file_private_data fpd = {0};
+
+    fpd.parent = &parent;
+    prepare_ring(&fpd, test_rings[0]);
+
+    kvfree_ExpectAndReturn(test_rings[0], cmp_pointer);
+    kmem_cache_free_ExpectAndReturn(fpd_cache, &fpd, cmp_pointer, cmp_pointer);
+
+    simple_fifo_free_rcu(&fpd.rcu);
+    return 0;
+}
+
+int test_simple_fifo_free_rcu_broadcast()
+{
+    struct simpleFifo_device_data parent;
+    struct file_private_data fpd = {0};
+
+    fpd.parent = &parent;
+    fpd.ring = &parent.sharedRing;
+
+    // The shared ring belongs to the device
+    kmem_cache_free_ExpectAndReturn(fpd_cache, &fpd, cmp_pointer, cmp_pointer);
+
+    simple_fifo_free_rcu(&fpd.rcu);
+    return 0;
+}
+
+/*
+ * A fifo created through configfs gets the first free minor after the fifos created at load time.
+ */
+static void expect_ida_alloc_minor(int minorToReturn)
+{
+    ida_alloc_range_ExpectAndReturn(&simple_fifo_minors, nb_fifos, SIMPLE_FIFO_MAX_FIFOS - 1, GFP_KERNEL, minorToReturn, cmp_pointer, cmp_u_int, cmp_u_int, cmp_int);
+}
+
+int test_configfs_make_item()
+{
+    struct simple_fifo_instance instance = {0};
+    struct class* classArg = (struct class*)0xf00ba4;
+    struct device dev;
+    struct cdev expectedCdev;
+    const int minor = 5;
+    my_class = classArg;
+    dev_major = 42;
+    fifo_capacity = TEST_FIFO_SIZE;
+
+    expect_ida_alloc_minor(minor);
+    kzalloc_ExpectAndReturn(sizeof(struct simple_fifo_instance), GFP_KERNEL, &instance, cmp_u_long, cmp_int);
+    kobject_init_ExpectAndReturn(&instance.kobj, &simple_fifo_instance_ktype, cmp_pointer, cmp_pointer);
+    expect_device_setup(&instance.data);
+    expect_cdev_init_ok(&instance.data);
+    // The cdev keeps the instance alive until its last file is released
+    cdev_set_parent_ExpectAndReturn(&instance.data.cdev, &instance.kobj, cmp_pointer, cmp_pointer);
+    expect_cdev_add(&instance.data, &expectedCdev, minor, 0);
+    device_create_ExpectAndReturn(classArg, NULL, test_devt(minor), NULL, "simplefifo-%s", &dev, cmp_pointer, cmp_pointer, cmp_int, cmp_pointer, cmp_str);
+    config_item_init_type_name_ExpectAndReturn(&instance.item, "tenant", &simple_fifo_instance_type, cmp_pointer, cmp_str, cmp_pointer);
+
+    struct config_item* item = simple_fifo_make_item(&simple_fifo_subsys.su_group, "tenant");
+    if(item != &instance.item)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_make_item didn't return the item of the instance (%p != %p)", item, &instance.item);
+    }
+    if(instance.minor != minor || instance.data.dev != &dev || instance.data.capacity != TEST_FIFO_SIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_make_item didn't set the instance up correctly");
+    }
+    return 0;
+}
+
+int test_configfs_make_item_no_minor()
+{
+    expect_ida_alloc_minor(-ENOSPC);
+
+    struct config_item* item = simple_fifo_make_item(&simple_fifo_subsys.su_group, "tenant");
+    if(!IS_ERR(item) || PTR_ERR(item) != -ENOSPC)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_make_item didn't return -ENOSPC (%p)", item);
+    }
+    return 0;
+}
+
+int test_configfs_make_item_cdev_add_fail()
+{
+    struct simple_fifo_instance instance = {0};
+    struct cdev expectedCdev;
+    const int minor = 5;
+    dev_major = 42;
+    fifo_capacity = TEST_FIFO_SIZE;
+
+    expect_ida_alloc_minor(minor);
+    kzalloc_ExpectAndReturn(sizeof(struct simple_fifo_instance), GFP_KERNEL, &instance, cmp_u_long, cmp_int);
+    kobject_init_ExpectAndReturn(&instance.kobj, &simple_fifo_instance_ktype, cmp_pointer, cmp_pointer);
+    expect_device_setup(&instance.data);
+    expect_cdev_init_ok(&instance.data);
+    cdev_set_parent_ExpectAndReturn(&instance.data.cdev, &instance.kobj, cmp_pointer, cmp_pointer);
+    expect_cdev_add(&instance.data, &expectedCdev, minor, -EBUSY);
+    // Dropping the only reference frees the instance and its minor
+    kobject_put_ExpectAndReturn(&instance.kobj, cmp_pointer);
+
+    struct config_item* item = simple_fifo_make_item(&simple_fifo_subsys.su_group, "tenant");
+    if(!IS_ERR(item) || PTR_ERR(item) != -EBUSY)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_make_item didn't return -EBUSY (%p)", item);
+    }
+    return 0;
+}
+
+int test_configfs_drop_item()
+{
+    struct simple_fifo_instance instance = {0};
+    struct class* classArg = (struct class*)0xf00ba4;
+    struct cdev expectedCdev = instance.data.cdev;
+    my_class = classArg;
+    dev_major = 42;
+    instance.minor = 5;
+
+    expect_device_destroy(classArg, 5);
+    expect_cdev_del(&expectedCdev);
+    config_item_put_ExpectAndReturn(&instance.item, cmp_pointer);
+
+    simple_fifo_drop_item(&simple_fifo_subsys.su_group, &instance.item);
+    return 0;
+}
+
+int test_configfs_instance_release()
+{
+    struct simple_fifo_instance instance = {0};
+    instance.minor = 5;
+
+    ida_free_ExpectAndReturn(&simple_fifo_minors, 5, cmp_pointer, cmp_u_int);
+    kfree_ExpectAndReturn(&instance, cmp_pointer);
+
+    simple_fifo_instance_release(&instance.kobj);
+    return 0;
+}
+
+int test_configfs_instance_release_broadcast()
+{
+    struct simple_fifo_instance instance = {0};
+    instance.minor = 5;
+    instance.data.broadcast = true;
+    instance.data.sharedRing.data = test_rings[0];
+
+    kvfree_ExpectAndReturn(test_rings[0], cmp_pointer);
+    ida_free_ExpectAndReturn(&simple_fifo_minors, 5, cmp_pointer, cmp_u_int);
+    kfree_ExpectAndReturn(&instance, cmp_pointer);
+
+    simple_fifo_instance_release(&instance.kobj);
+    return 0;
+}
+
+int test_configfs_fifo_size_store()
+{
+    struct simple_fifo_instance instance = {0};
+    unsigned long long requestedSize = SIMPLE_FIFO_MIN_SIZE;
+    const char page[] = "4096\n";
+    instance.data.capacity = TEST_FIFO_SIZE;
+
+    kstrtoull_ExpectReturnAndOutput(page, 0, NULL, 0, cmp_str, cmp_u_int, NULL, &requestedSize);
+    __roundup_pow_of_two_ExpectAndReturn(SIMPLE_FIFO_MIN_SIZE, SIMPLE_FIFO_MIN_SIZE, cmp_u_long);
+
+    ssize_t rv = simple_fifo_instance_fifo_size_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != (ssize_t)(sizeof(page) - 1))
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_fifo_size_store didn't accept the size (%zd)", rv);
+    }
+    if(instance.data.capacity != SIMPLE_FIFO_MIN_SIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_fifo_size_store didn't set the capacity (%zu)", instance.data.capacity);
+    }
+    return 0;
+}
+
+int test_configfs_fifo_size_store_broadcast()
+{
+    struct simple_fifo_instance instance = {0};
+    unsigned long long requestedSize = SIMPLE_FIFO_MIN_SIZE;
+    const char page[] = "4096\n";
+    instance.data.capacity = TEST_FIFO_SIZE;
+    instance.data.broadcast = true;
+
+    kstrtoull_ExpectReturnAndOutput(page, 0, NULL, 0, cmp_str, cmp_u_int, NULL, &requestedSize);
+
+    ssize_t rv = simple_fifo_instance_fifo_size_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != -EBUSY || instance.data.capacity != TEST_FIFO_SIZE)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_fifo_size_store didn't return -EBUSY (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_configfs_slow_reader_policy_store()
+{
+    struct simple_fifo_instance instance = {0};
+    unsigned int policy = SIMPLE_FIFO_POLICY_DETACH;
+    const char page[] = "3\n";
+
+    kstrtouint_ExpectReturnAndOutput(page, 0, NULL, 0, cmp_str, cmp_u_int, NULL, &policy);
+
+    ssize_t rv = simple_fifo_instance_slow_reader_policy_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != (ssize_t)(sizeof(page) - 1) || instance.data.policy != SIMPLE_FIFO_POLICY_DETACH)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_slow_reader_policy_store didn't set the policy (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_configfs_slow_reader_policy_store_invalid()
+{
+    struct simple_fifo_instance instance = {0};
+    unsigned int policy = SIMPLE_FIFO_POLICY_DETACH + 1;
+    const char page[] = "4\n";
+
+    kstrtouint_ExpectReturnAndOutput(page, 0, NULL, 0, cmp_str, cmp_u_int, NULL, &policy);
+
+    ssize_t rv = simple_fifo_instance_slow_reader_policy_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != -EINVAL || instance.data.policy != SIMPLE_FIFO_POLICY_BLOCK)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_slow_reader_policy_store didn't return -EINVAL (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_configfs_record_mode_store()
+{
+    struct simple_fifo_instance instance = {0};
+    bool recordMode = true;
+    const char page[] = "1\n";
+
+    kstrtobool_ExpectReturnAndOutput(page, NULL, 0, cmp_str, NULL, &recordMode);
+    mutex_lock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_instance_record_mode_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != (ssize_t)(sizeof(page) - 1) || !instance.data.recordMode)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_record_mode_store didn't set the record mode (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_configfs_record_mode_store_busy()
+{
+    struct simple_fifo_instance instance = {0};
+    bool recordMode = true;
+    const char page[] = "1\n";
+    atomic_set(&instance.data.openCount, 1);
+
+    // The rings of the opened files hold a byte stream
+    kstrtobool_ExpectReturnAndOutput(page, NULL, 0, cmp_str, NULL, &recordMode);
+    mutex_lock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_instance_record_mode_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != -EBUSY || instance.data.recordMode)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_record_mode_store didn't return -EBUSY (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_configfs_slot_size_store()
+{
+    struct simple_fifo_instance instance = {0};
+    unsigned int slotSize = 64;
+    const char page[] = "64\n";
+
+    kstrtouint_ExpectReturnAndOutput(page, 0, NULL, 0, cmp_str, cmp_u_int, NULL, &slotSize);
+    mutex_lock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_instance_slot_size_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != (ssize_t)(sizeof(page) - 1) || instance.data.slotSize != 64)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_slot_size_store didn't set the slot size (%zd)", rv);
+    }
+    return 0;
+}
+
+int test_configfs_slot_size_store_record_mode()
+{
+    struct simple_fifo_instance instance = {0};
+    unsigned int slotSize = 64;
+    const char page[] = "64\n";
+    instance.data.recordMode = true;
+
+    // Records already carry their length
+    kstrtouint_ExpectReturnAndOutput(page, 0, NULL, 0, cmp_str, cmp_u_int, NULL, &slotSize);
+    mutex_lock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+    mutex_unlock_ExpectAndReturn(&instance.data.write_mutex, cmp_pointer);
+
+    ssize_t rv = simple_fifo_instance_slot_size_store(&instance.item, page, sizeof(page) - 1);
+    if(rv != -EINVAL || instance.data.slotSize != 0)
+    {
+        easyMock_addError(easyMock_true, "simple_fifo_instance_slot_size_store didn't return -EINVAL (%zd)", rv);
+    }
+    return 0;
+}
+
 int test_exit_module()
 {
     struct class* ptr_to_check = (struct class*)0xf00ba4;
     dev_major = 42;
     my_class = ptr_to_check;
+    fpd_cache = test_fpd_cache;
+    simpleFifo_devices = test_devices;
+    memset(test_devices, 0, sizeof(test_devices));
+    struct cdev expectedCdev = test_devices[0].cdev;
 
-    expect_device_destroy(ptr_to_check);
+    configfs_unregister_subsystem_ExpectAndReturn(&simple_fifo_subsys, cmp_pointer);
+    expect_device_destroy(ptr_to_check, 0);
+    expect_cdev_del(&expectedCdev);
 
     class_destroy_ExpectAndReturn(ptr_to_check, cmp_pointer);
 
     expect_unregister_chrdev_region();
+    rcu_barrier_ExpectAndReturn();
+    kfree_ExpectAndReturn(test_devices, cmp_pointer);
+    expect_fpd_cache_destroy(test_fpd_cache);
+    ida_destroy_ExpectAndReturn(&simple_fifo_minors, cmp_pointer);
     _printk_ExpectAndReturn(NULL, 0, NULL);
 
     simple_fifo_exit();
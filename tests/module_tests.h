@@ -11,9 +11,21 @@ extern "C"
     int test_init_module_class_create_fail();
     int test_init_module_cdev_add_fail();
     int test_init_module_device_create_fail();
+    int test_init_module_invalid_fifo_size();
+    int test_init_module_invalid_slow_reader_policy();
+    int test_init_module_invalid_slot_size();
+    int test_init_module_fpd_cache_create_fail();
+    int test_init_module_invalid_nb_fifos();
+    int test_init_module_kcalloc_fail();
+    int test_init_module_two_fifos();
+    int test_init_module_second_fifo_fails();
+    int test_init_module_configfs_register_fail();
 
     int test_simple_fifo_open();
-    int test_simple_fifo_open_devm_kzalloc_fail();
+    int test_simple_fifo_open_alloc_fail();
+    int test_simple_fifo_open_kvmalloc_fail();
+    int test_simple_fifo_open_broadcast();
+    int test_simple_fifo_open_write_only();
 
     int test_simple_fifo_write_simple_write();
     int test_simple_fifo_write_simple_write_two_files_write_first_file();
@@ -21,21 +33,117 @@ extern "C"
     int test_simple_fifo_write_wrapper_write();
     int test_simple_fifo_write_double_write();
     int test_simple_fifo_write_copy_from_user_fails();
+    int test_simple_fifo_write_fault_in_retry();
     int test_simple_fifo_write_fifo_full();
+    int test_simple_fifo_write_cached_writable();
+    int test_simple_fifo_write_readers_changed();
+    int test_simple_fifo_write_zero_size();
     int test_simple_fifo_write_fifo_partial_write();
+    int test_simple_fifo_write_atomic_no_room();
+    int test_simple_fifo_write_full_length();
     int test_simple_fifo_write_fifo_write_first_file_second_is_full();
     int test_simple_fifo_write_fifo_write_first_file_second_is_partial_write();
     int test_simple_fifo_write_fifo_write_two_file_big_data();
     int test_simple_fifo_write_fifo_write_two_file_one_is_write_only();
+    int test_simple_fifo_write_broadcast_two_files();
+    int test_simple_fifo_write_broadcast_slowest_reader_limits_write();
+    int test_simple_fifo_write_broadcast_all_detached();
+    int test_simple_fifo_write_broadcast_no_reader();
+    int test_simple_fifo_write_broadcast_no_reader_record_too_big();
+    int test_simple_fifo_write_drop_oldest();
+    int test_simple_fifo_write_drop_newest();
+    int test_simple_fifo_write_detach();
+    int test_simple_fifo_write_broadcast_drop_oldest();
+    int test_simple_fifo_write_channel();
+    int test_simple_fifo_write_broadcast_channel();
+    int test_simple_fifo_write_record();
+    int test_simple_fifo_write_record_no_room();
+    int test_simple_fifo_write_record_too_big();
+    int test_simple_fifo_write_record_drop_oldest();
+    int test_simple_fifo_write_partial_slot();
+    int test_simple_fifo_write_iter();
+    int test_simple_fifo_write_iter_fault();
+    int test_simple_fifo_write_iter_nowait_locked();
 
     int test_simple_fifo_read_simple_read();
+    int test_simple_fifo_read_record();
+    int test_simple_fifo_read_record_buffer_too_small();
+    int test_simple_fifo_read_record_beyond_pending();
+    int test_simple_fifo_read_broadcast_overtaken();
+    int test_simple_fifo_read_whole_slots();
+    int test_simple_fifo_read_buffer_smaller_than_slot();
+    int test_simple_fifo_read_iter();
+    int test_simple_fifo_read_iter_nowait_empty();
     int test_simple_fifo_read_double_read();
     int test_simple_fifo_read_empty_fifo();
     int test_simple_fifo_read_wrap_read();
     int test_simple_fifo_read_request_too_big();
     int test_simple_fifo_read_copy_to_user_fails();
+    int test_simple_fifo_read_fault_in_retry();
+    int test_simple_fifo_read_detached();
+
+    int test_simple_fifo_poll_empty();
+    int test_simple_fifo_poll_data_pending();
+    int test_simple_fifo_poll_other_reader_full();
+    int test_simple_fifo_poll_detached();
+    int test_simple_fifo_poll_write_only();
+    int test_simple_fifo_uring_cmd_publish();
+    int test_simple_fifo_uring_cmd_publish_too_big();
+    int test_simple_fifo_uring_cmd_publish_read_only();
+    int test_simple_fifo_uring_cmd_consume();
+    int test_simple_fifo_uring_cmd_occupancy();
+    int test_simple_fifo_uring_cmd_occupancy_overtaken();
+    int test_simple_fifo_uring_cmd_invalid_flags();
+
+    int test_simple_fifo_ioctl_get_size();
+    int test_simple_fifo_ioctl_set_size();
+    int test_simple_fifo_ioctl_set_size_invalid();
+    int test_simple_fifo_ioctl_set_size_busy();
+    int test_simple_fifo_ioctl_set_size_broadcast();
+    int test_simple_fifo_ioctl_get_policy();
+    int test_simple_fifo_ioctl_set_policy();
+    int test_simple_fifo_ioctl_set_policy_broadcast_drop_newest();
+    int test_simple_fifo_ioctl_set_size_mapped();
+    int test_simple_fifo_ioctl_set_policy_mapped();
+    int test_simple_fifo_ioctl_consume();
+    int test_simple_fifo_ioctl_consume_too_much();
+    int test_simple_fifo_ioctl_consume_inside_record();
+    int test_simple_fifo_ioctl_commit();
+    int test_simple_fifo_ioctl_commit_out_of_range();
+    int test_simple_fifo_mmap();
+    int test_simple_fifo_mmap_writable();
+    int test_simple_fifo_mmap_drop_oldest();
+    int test_simple_fifo_mmap_staging();
+    int test_simple_fifo_mmap_staging_twice();
+    int test_simple_fifo_ioctl_bind_channel();
+    int test_simple_fifo_ioctl_bind_existing_channel();
+    int test_simple_fifo_ioctl_bind_channel_twice();
+    int test_simple_fifo_ioctl_bind_channel_invalid_name();
+    int test_simple_fifo_ioctl_bind_channel_broadcast();
+    int test_simple_fifo_ioctl_bind_channel_broadcast_write();
 
     int test_simple_fifo_release();
+    int test_simple_fifo_release_write_only();
+    int test_simple_fifo_release_staging();
+    int test_simple_fifo_release_last_of_channel();
+    int test_simple_fifo_release_write_only_channel();
+    int test_simple_fifo_free_rcu();
+    int test_simple_fifo_free_rcu_broadcast();
+
+    int test_configfs_make_item();
+    int test_configfs_make_item_no_minor();
+    int test_configfs_make_item_cdev_add_fail();
+    int test_configfs_drop_item();
+    int test_configfs_instance_release();
+    int test_configfs_instance_release_broadcast();
+    int test_configfs_fifo_size_store();
+    int test_configfs_fifo_size_store_broadcast();
+    int test_configfs_slow_reader_policy_store();
+    int test_configfs_slow_reader_policy_store_invalid();
+    int test_configfs_record_mode_store();
+    int test_configfs_record_mode_store_busy();
+    int test_configfs_slot_size_store();
+    int test_configfs_slot_size_store_record_mode();
 
     int test_exit_module();
 